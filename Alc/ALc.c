@@ -138,6 +138,8 @@ static const ALCfunction alcFunctions[] = {
     { "alcLoopbackOpenDeviceSOFT",  (ALCvoid *) alcLoopbackOpenDeviceSOFT},
     { "alcIsRenderFormatSupportedSOFT",(ALCvoid *) alcIsRenderFormatSupportedSOFT},
     { "alcRenderSamplesSOFT",       (ALCvoid *) alcRenderSamplesSOFT         },
+
+    { "alcImportBufferSOFT",        (ALCvoid *) alcImportBufferSOFT      },
 #endif
     { "alEnable",                   (ALCvoid *) alEnable                 },
     { "alDisable",                  (ALCvoid *) alDisable                },
@@ -249,6 +251,13 @@ static const ALCfunction alcFunctions[] = {
 
     { "alBufferSubDataSOFT",        (ALCvoid *) alBufferSubDataSOFT      },
 
+    { "alBufferDataStatic",         (ALCvoid *) alBufferDataStatic       },
+
+    { "alBufferFileSOFT",           (ALCvoid *) alBufferFileSOFT         },
+    { "alBufferFileDescriptorSOFT", (ALCvoid *) alBufferFileDescriptorSOFT},
+
+    { "alBufferDataAsyncSOFT",      (ALCvoid *) alBufferDataAsyncSOFT    },
+
     { "alBufferSamplesSOFT",        (ALCvoid *) alBufferSamplesSOFT      },
     { "alBufferSubSamplesSOFT",     (ALCvoid *) alBufferSubSamplesSOFT   },
     { "alGetBufferSamplesSOFT",     (ALCvoid *) alGetBufferSamplesSOFT   },
@@ -348,7 +357,7 @@ static const ALCchar alcNoDeviceExtList[] =
 static const ALCchar alcExtensionList[] =
     "ALC_ENUMERATE_ALL_EXT ALC_ENUMERATION_EXT ALC_EXT_CAPTURE "
     "ALC_EXT_DEDICATED ALC_EXT_disconnect ALC_EXT_EFX "
-    "ALC_EXT_thread_local_context ALC_SOFT_loopback";
+    "ALC_EXT_thread_local_context ALC_SOFTX_buffer_import ALC_SOFT_loopback";
 static const ALCint alcMajorVersion = 1;
 static const ALCint alcMinorVersion = 1;
 
@@ -379,8 +388,10 @@ static const ALchar alExtList[] =
     "AL_EXT_ALAW AL_EXT_DOUBLE AL_EXT_EXPONENT_DISTANCE AL_EXT_FLOAT32 "
     "AL_EXT_IMA4 AL_EXT_LINEAR_DISTANCE AL_EXT_MCFORMATS AL_EXT_MULAW "
     "AL_EXT_MULAW_MCFORMATS AL_EXT_OFFSET AL_EXT_source_distance_model "
-    "AL_LOKI_quadriphonic AL_SOFT_buffer_samples AL_SOFT_buffer_sub_data "
-    "AL_SOFTX_deferred_updates AL_SOFT_direct_channels AL_SOFT_loop_points";
+    "AL_EXT_STATIC_BUFFER AL_LOKI_quadriphonic AL_SOFTX_buffer_async "
+    "AL_SOFTX_buffer_file AL_SOFT_buffer_samples AL_SOFT_buffer_sub_data "
+    "AL_SOFTX_deferred_updates AL_SOFT_direct_channels AL_SOFT_loop_points "
+    "AL_SOFTX_source_level AL_SOFTX_source_priority";
 
 // Mixing Priority Level
 ALint RTPrioLevel;
@@ -546,6 +557,7 @@ static void alc_deinit(void)
     int i;
 
     ReleaseALC();
+    StopBufferUploads();
 
     memset(&PlaybackBackend, 0, sizeof(PlaybackBackend));
     memset(&CaptureBackend, 0, sizeof(CaptureBackend));
@@ -581,8 +593,6 @@ static void alc_initconfig(void)
 
     ReadALConfig();
 
-    InitHrtf();
-
 #ifdef _WIN32
     RTPrioLevel = 1;
 #else
@@ -592,7 +602,12 @@ static void alc_initconfig(void)
 
     if(ConfigValueStr(NULL, "resampler", &str))
     {
-        if(strcasecmp(str, "point") == 0 || strcasecmp(str, "none") == 0)
+        if(strcasecmp(str, "auto") == 0)
+        {
+            DefaultResampler = CubicResampler;
+            ResamplerLod = AL_TRUE;
+        }
+        else if(strcasecmp(str, "point") == 0 || strcasecmp(str, "none") == 0)
             DefaultResampler = PointResampler;
         else if(strcasecmp(str, "linear") == 0)
             DefaultResampler = LinearResampler;
@@ -621,6 +636,53 @@ static void alc_initconfig(void)
 
     EmulateEAXReverb = GetConfigValueBool("reverb", "emulate-eax", AL_FALSE);
 
+    CoalesceEffectSlots = GetConfigValueBool(NULL, "coalesce-slots", AL_FALSE);
+
+    WaitPendingBuffers = GetConfigValueBool(NULL, "wait-pending-buffers", AL_TRUE);
+
+    ConvertThreads = GetProcessorCount();
+    if(ConfigValueInt(NULL, "convert-threads", &n) && n > 0)
+        ConvertThreads = n;
+    if(ConvertThreads > MAX_CONVERT_THREADS)
+        ConvertThreads = MAX_CONVERT_THREADS;
+    ConfigValueUInt(NULL, "convert-threshold", &ConvertThreshold);
+
+    ShareBufferData = GetConfigValueBool(NULL, "share-buffer-data", AL_FALSE);
+
+    if(ConfigValueStr(NULL, "resample-cache", &str))
+    {
+        if(strcasecmp(str, "lazy") == 0)
+            BufferResampleCache = ResampleCacheLazy;
+        else if(strcasecmp(str, "eager") == 0)
+            BufferResampleCache = ResampleCacheEager;
+        else if(strcasecmp(str, "none") != 0)
+            WARN("Invalid resample-cache: %s\n", str);
+    }
+
+    if(ConfigValueFloat(NULL, "hrtf_lod_gain", &valf))
+        HrtfLodGain = aluPow(10.0f, valf / 20.0f);
+    if(ConfigValueFloat(NULL, "hrtf_lod_distance", &valf))
+        HrtfLodDistance = maxf(valf, 0.0f);
+    if(ConfigValueInt(NULL, "hrtf_lod_priority", &n))
+        HrtfLodPriority = n;
+
+    if(ConfigValueFloat(NULL, "resampler_lod_gain", &valf))
+        ResamplerLodGain = aluPow(10.0f, valf / 20.0f);
+    if(ConfigValueFloat(NULL, "resampler_lod_point_gain", &valf))
+        ResamplerLodPointGain = aluPow(10.0f, valf / 20.0f);
+    if(ConfigValueFloat(NULL, "resampler_lod_distance", &valf))
+        ResamplerLodDistance = maxf(valf, 0.0f);
+    if(ConfigValueInt(NULL, "resampler_lod_priority", &n))
+        ResamplerLodPriority = n;
+
+    if(ConfigValueInt("reverb", "rate-divisor", &n))
+    {
+        if(n == 1) ReverbRateShift = 0;
+        else if(n == 2) ReverbRateShift = 1;
+        else if(n == 4) ReverbRateShift = 2;
+        else WARN("Invalid reverb rate divisor: %d\n", n);
+    }
+
     if(((devs=getenv("ALSOFT_DRIVERS")) && devs[0]) ||
        ConfigValueStr(NULL, "drivers", &devs))
     {
@@ -1015,6 +1077,37 @@ static ALCboolean IsValidALCChannels(ALCenum channels)
     return ALC_FALSE;
 }
 
+/* GetBufferStorageType
+ *
+ * Reads the sample type a device's buffers store converted data as. Float
+ * keeps the most precision, while 16- or 8-bit trades it for memory and
+ * mixer bandwidth.
+ */
+static enum FmtType GetBufferStorageType(void)
+{
+    static const struct {
+        const char name[16];
+        enum FmtType type;
+    } typelist[] = {
+        { "int8",    FmtByte  },
+        { "int16",   FmtShort },
+        { "float32", FmtFloat },
+    };
+    const char *str;
+    size_t i;
+
+    if(ConfigValueStr(NULL, "buffer-storage-type", &str))
+    {
+        for(i = 0;i < COUNTOF(typelist);i++)
+        {
+            if(strcasecmp(typelist[i].name, str) == 0)
+                return typelist[i].type;
+        }
+        ERR("Unsupported buffer-storage-type: %s\n", str);
+    }
+    return FmtFloat;
+}
+
 
 /* alcSetError
  *
@@ -1241,8 +1334,6 @@ static ALCenum UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
           DevFmtTypeString(device->FmtType), device->Frequency,
           device->UpdateSize, device->NumUpdates);
 
-    aluInitPanning(device);
-
     for(i = 0;i < MAXCHANNELS;i++)
     {
         device->ClickRemoval[i] = 0.0f;
@@ -1254,7 +1345,22 @@ static ALCenum UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
         device->Hrtf = GetHrtf(device);
     TRACE("HRTF %s\n", device->Hrtf?"enabled":"disabled");
 
-    if(!device->Hrtf && device->Bs2bLevel > 0 && device->Bs2bLevel <= 6)
+    free(device->HrtfBus);
+    device->HrtfBus = NULL;
+    if(device->Hrtf && GetConfigValueBool(NULL, "hrtf_bus", AL_FALSE))
+    {
+        device->HrtfBus = CreateHrtfBus(device->Hrtf);
+        if(device->HrtfBus)
+            device->Hrtf = NULL;
+    }
+    TRACE("HRTF bus %s\n", device->HrtfBus?"enabled":"disabled");
+
+    if(device->Hrtf && !device->HrtfCache)
+        device->HrtfCache = CreateHrtfCache();
+
+    aluInitPanning(device);
+
+    if(!device->Hrtf && !device->HrtfBus && device->Bs2bLevel > 0 && device->Bs2bLevel <= 6)
     {
         if(!device->Bs2b)
         {
@@ -1328,6 +1434,14 @@ static ALCenum UpdateDeviceParams(ALCdevice *device, const ALCint *attrList)
                 source->Send[s].WetGainHF = 1.0f;
                 s++;
             }
+            if(!device->Hrtf)
+            {
+                free(source->HrtfState);
+                source->HrtfState = NULL;
+            }
+            else if(!source->HrtfState && (source->state == AL_PLAYING ||
+                                           source->state == AL_PAUSED))
+                source->HrtfState = calloc(1, sizeof(*source->HrtfState));
             source->NeedsUpdate = AL_FALSE;
             ALsource_Update(source, context);
         }
@@ -1397,6 +1511,12 @@ static ALCvoid FreeDevice(ALCdevice *device)
     free(device->Bs2b);
     device->Bs2b = NULL;
 
+    free(device->HrtfCache);
+    device->HrtfCache = NULL;
+
+    free(device->HrtfBus);
+    device->HrtfBus = NULL;
+
     free(device->szDeviceName);
     device->szDeviceName = NULL;
 
@@ -1507,6 +1627,7 @@ static ALCvoid FreeContext(ALCcontext *context)
         ReleaseALSources(context);
     }
     ResetUIntMap(&context->SourceMap);
+    ReleaseALSourceBlocks(context);
 
     if(context->EffectSlotMap.size > 0)
     {
@@ -2473,6 +2594,9 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
     device->LastError = ALC_NO_ERROR;
 
     device->Flags = 0;
+    device->Hrtf = NULL;
+    device->HrtfCache = NULL;
+    device->HrtfBus = NULL;
     device->Bs2b = NULL;
     device->Bs2bLevel = 0;
     device->szDeviceName = NULL;
@@ -2622,6 +2746,8 @@ ALC_API ALCdevice* ALC_APIENTRY alcOpenDevice(const ALCchar *deviceName)
     ConfigValueUInt(NULL, "sends", &device->NumAuxSends);
     if(device->NumAuxSends > MAX_SENDS) device->NumAuxSends = MAX_SENDS;
 
+    device->BufferStorageType = GetBufferStorageType();
+
     ConfigValueInt(NULL, "cf_level", &device->Bs2bLevel);
 
     device->NumStereoSources = 1;
@@ -2737,6 +2863,9 @@ ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *deviceN
     device->LastError = ALC_NO_ERROR;
 
     device->Flags = 0;
+    device->Hrtf = NULL;
+    device->HrtfCache = NULL;
+    device->HrtfBus = NULL;
     device->Bs2b = NULL;
     device->Bs2bLevel = 0;
     device->szDeviceName = NULL;
@@ -2768,6 +2897,8 @@ ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *deviceN
     ConfigValueUInt(NULL, "sends", &device->NumAuxSends);
     if(device->NumAuxSends > MAX_SENDS) device->NumAuxSends = MAX_SENDS;
 
+    device->BufferStorageType = GetBufferStorageType();
+
     device->NumStereoSources = 1;
     device->NumMonoSources = device->MaxNoOfSources - device->NumStereoSources;
 
@@ -2822,6 +2953,38 @@ ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffe
 }
 
 
+/* alcImportBufferSOFT
+ *
+ * Makes a buffer use the samples of a buffer on another (or the same) device,
+ * without copying them. Both buffers keep a reference to the samples, so a
+ * process running many devices only needs to load them once.
+ */
+ALC_API ALCboolean ALC_APIENTRY alcImportBufferSOFT(ALCdevice *device, ALCuint buffer, ALCdevice *srcdevice, ALCuint srcbuffer)
+{
+    ALCdevice *srcdev = NULL;
+    ALCboolean ret = ALC_FALSE;
+    ALbuffer *dst, *src;
+    ALenum err;
+
+    if(!(device=VerifyDevice(device)) || device->Type == Capture)
+        alcSetError(device, ALC_INVALID_DEVICE);
+    else if(!(srcdev=VerifyDevice(srcdevice)) || srcdev->Type == Capture)
+        alcSetError(device, ALC_INVALID_DEVICE);
+    else if((dst=LookupBuffer(device, buffer)) == NULL ||
+            (src=LookupBuffer(srcdev, srcbuffer)) == NULL)
+        alcSetError(device, ALC_INVALID_VALUE);
+    else if((err=ImportBuffer(dst, src)) != AL_NO_ERROR)
+        alcSetError(device, (err == AL_OUT_OF_MEMORY) ? ALC_OUT_OF_MEMORY :
+                                                        ALC_INVALID_VALUE);
+    else
+        ret = ALC_TRUE;
+    if(srcdev) ALCdevice_DecRef(srcdev);
+    if(device) ALCdevice_DecRef(device);
+
+    return ret;
+}
+
+
 static void ReleaseALC(void)
 {
     ALCdevice *dev;
@@ -48,6 +48,28 @@ ALfloat ConeScale = 0.5f;
 /* Localized Z scalar for mono sources */
 ALfloat ZScale = 1.0f;
 
+/* Hand the input of effect slots to earlier slots with identical effects */
+ALboolean CoalesceEffectSlots = AL_FALSE;
+
+/* HRTF level of detail. Sources with a priority below HrtfLodPriority are
+ * panned instead of using HRTF, as are sources at that priority which are
+ * quieter than HrtfLodGain or further than HrtfLodDistance (0 disables the
+ * distance test). Sources above it always use HRTF. */
+ALfloat HrtfLodGain = 0.0f;
+ALfloat HrtfLodDistance = 0.0f;
+ALint HrtfLodPriority = 0;
+
+/* Resampler level of detail, with resampler = auto. Positional sources at
+ * ResamplerLodPriority use linear resampling when quieter than
+ * ResamplerLodGain (-24dB) or further than ResamplerLodDistance (0 disables
+ * it), and point when quieter than ResamplerLodPointGain (-50dB). Sources
+ * below that priority use linear at best, and ones above it keep cubic. */
+ALboolean ResamplerLod = AL_FALSE;
+ALfloat ResamplerLodGain = 0.0631f;
+ALfloat ResamplerLodPointGain = 0.00316f;
+ALfloat ResamplerLodDistance = 0.0f;
+ALint ResamplerLodPriority = 0;
+
 
 static __inline ALvoid aluMatrixVector(ALfloat *vector,ALfloat w,ALfloat matrix[4][4])
 {
@@ -107,6 +129,7 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     };
 
     ALCdevice *Device = ALContext->Device;
+    ALhrtfState *HrtfState = Device->Hrtf ? ALSource->HrtfState : NULL;
     ALfloat SourceVolume,ListenerGain,MinVolume,MaxVolume;
     ALbufferlistitem *BufferListItem;
     enum FmtChannels Channels;
@@ -171,10 +194,16 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         }
         BufferListItem = BufferListItem->next;
     }
-    if(!DirectChannels && Device->Hrtf)
+    if(!DirectChannels && HrtfState)
+    {
         ALSource->Params.DoMix = SelectHrtfMixer(Resampler);
+        ALSource->Params.DoMixPoint = SelectHrtfMixer(PointResampler);
+    }
     else
+    {
         ALSource->Params.DoMix = SelectMixer(Resampler);
+        ALSource->Params.DoMixPoint = SelectMixer(PointResampler);
+    }
 
     /* Calculate gains */
     DryGain  = clampf(SourceVolume, MinVolume, MaxVolume);
@@ -262,30 +291,30 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
             }
         }
     }
-    else if(Device->Hrtf)
+    else if(HrtfState)
     {
         for(c = 0;c < num_channels;c++)
         {
             if(chans[c].channel == LFE)
             {
                 /* Skip LFE */
-                ALSource->Params.HrtfDelay[c][0] = 0;
-                ALSource->Params.HrtfDelay[c][1] = 0;
+                HrtfState->Delay[c][0] = 0;
+                HrtfState->Delay[c][1] = 0;
                 for(i = 0;i < HRIR_LENGTH;i++)
                 {
-                    ALSource->Params.HrtfCoeffs[c][i][0] = 0.0f;
-                    ALSource->Params.HrtfCoeffs[c][i][1] = 0.0f;
+                    HrtfState->Coeffs[c][i][0] = 0.0f;
+                    HrtfState->Coeffs[c][i][1] = 0.0f;
                 }
             }
             else
             {
                 /* Get the static HRIR coefficients and delays for this
                  * channel. */
-                GetLerpedHrtfCoeffs(Device->Hrtf,
+                GetLerpedHrtfCoeffs(Device->Hrtf, Device->HrtfCache,
                                     0.0f, chans[c].angle,
                                     DryGain*ListenerGain,
-                                    ALSource->Params.HrtfCoeffs[c],
-                                    ALSource->Params.HrtfDelay[c]);
+                                    HrtfState->Coeffs[c],
+                                    HrtfState->Delay[c]);
             }
             ALSource->HrtfCounter = 0;
         }
@@ -338,9 +367,91 @@ ALvoid CalcNonAttnSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     }
 }
 
+static ALboolean UseLowHrtfDetail(const ALsource *ALSource, ALfloat DryGain, ALfloat Distance)
+{
+    ALfloat scale;
+
+    if(ALSource->Priority != HrtfLodPriority)
+        return (ALSource->Priority < HrtfLodPriority);
+
+    // A panned source has to pass the thresholds by a margin to get HRTF
+    // back, so it doesn't keep switching when it sits near one.
+    scale = (ALSource->HrtfLod == HrtfLodFull) ? 1.0f : 1.25f;
+    if(DryGain < HrtfLodGain*scale)
+        return AL_TRUE;
+    if(HrtfLodDistance > 0.0f && Distance*scale > HrtfLodDistance)
+        return AL_TRUE;
+    return AL_FALSE;
+}
+
+// Sets the source's running HRIR to step toward a plain panned response (the
+// gains on the first tap, with no delay) over the given number of samples.
+static ALvoid SetPannedHrtfTarget(ALsource *ALSource, ALfloat gainL, ALfloat gainR, ALuint count)
+{
+    ALfloat (*coeffs)[2] = ALSource->HrtfState->Coeffs[0];
+    ALfloat (*coeffStep)[2] = ALSource->HrtfState->CoeffStep;
+    ALuint *delays = ALSource->HrtfState->Delay[0];
+    ALint *delayStep = ALSource->HrtfState->DelayStep;
+    ALint counter = ALSource->HrtfCounter;
+    ALfloat step = 1.0f / count;
+    ALfloat left, right;
+    ALuint i;
+
+    for(i = 0;i < HRIR_LENGTH;i++)
+    {
+        left = coeffs[i][0] - (coeffStep[i][0] * counter);
+        right = coeffs[i][1] - (coeffStep[i][1] * counter);
+
+        coeffs[i][0] = (i == 0) ? gainL : 0.0f;
+        coeffs[i][1] = (i == 0) ? gainR : 0.0f;
+
+        coeffStep[i][0] = step * (coeffs[i][0] - left);
+        coeffStep[i][1] = step * (coeffs[i][1] - right);
+    }
+
+    left = (ALfloat)(delays[0] - (delayStep[0] * counter));
+    right = (ALfloat)(delays[1] - (delayStep[1] * counter));
+
+    delays[0] = 0;
+    delays[1] = 0;
+
+    delayStep[0] = fastf2i(step * -left);
+    delayStep[1] = fastf2i(step * -right);
+
+    ALSource->HrtfCounter = count;
+}
+
+// Checks if the HRIR taps past the first have finished draining out of the
+// source's accumulation buffer (to -100dB).
+static ALboolean HrtfValuesDrained(const ALsource *ALSource)
+{
+    ALuint i;
+
+    for(i = 1;i < HRIR_LENGTH;i++)
+    {
+        const ALfloat *value = ALSource->HrtfState->Values[0][(ALSource->HrtfOffset+i)&HRIR_MASK];
+        if(aluFabs(value[0]) > 0.00001f || aluFabs(value[1]) > 0.00001f)
+            return AL_FALSE;
+    }
+    return AL_TRUE;
+}
+
+static enum Resampler GetLodResampler(const ALsource *ALSource, ALfloat Gain, ALfloat Distance, ALfloat scale)
+{
+    if(ALSource->Priority > ResamplerLodPriority)
+        return CubicResampler;
+    if(Gain < ResamplerLodPointGain*scale)
+        return PointResampler;
+    if(ALSource->Priority < ResamplerLodPriority || Gain < ResamplerLodGain*scale ||
+       (ResamplerLodDistance > 0.0f && Distance*scale > ResamplerLodDistance))
+        return LinearResampler;
+    return CubicResampler;
+}
+
 ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
 {
     const ALCdevice *Device = ALContext->Device;
+    ALhrtfState *HrtfState = Device->Hrtf ? ALSource->HrtfState : NULL;
     ALfloat InnerAngle,OuterAngle,Angle,Distance,ClampedDist;
     ALfloat Direction[3],Position[3],SourceToListener[3];
     ALfloat Velocity[3],ListenerVel[3];
@@ -368,6 +479,7 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
     ALfloat Pitch;
     ALuint Frequency;
     ALint NumSends;
+    ALboolean HrtfFadeIn, HrtfFadeOut;
     ALfloat cw;
     ALint i, j;
 
@@ -681,12 +793,100 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         }
         BufferListItem = BufferListItem->next;
     }
-    if(Device->Hrtf)
+    if(ResamplerLod)
+    {
+        // Pick a cheaper resampler for sources that won't be heard clearly,
+        // going by the loudest path. The source's padding stays that of its
+        // own resampler, and click removal smooths over the switch.
+        enum Resampler lod;
+        ALfloat gain = DryGain;
+        for(i = 0;i < NumSends;i++)
+        {
+            if(ALSource->Send[i].Slot)
+                gain = maxf(gain, WetGain[i]);
+        }
+
+        lod = GetLodResampler(ALSource, gain, Distance, 1.0f);
+        // Only go back up once past the thresholds by a margin, so sources
+        // near one don't keep switching.
+        if(lod > ALSource->LodResampler)
+        {
+            lod = GetLodResampler(ALSource, gain, Distance, 1.25f);
+            if(lod < ALSource->LodResampler)
+                lod = ALSource->LodResampler;
+        }
+        ALSource->LodResampler = lod;
+        if(lod < Resampler)
+            Resampler = lod;
+    }
+
+    HrtfFadeIn = AL_FALSE;
+    HrtfFadeOut = AL_FALSE;
+    if(HrtfState)
+    {
+        ALboolean lowDetail = UseLowHrtfDetail(ALSource, DryGain, Distance);
+
+        if(!ALSource->HrtfMoving)
+        {
+            // Nothing's been mixed yet, so switch immediately
+            ALSource->HrtfLod = lowDetail ? HrtfLodPanned : HrtfLodFull;
+        }
+        else if(!lowDetail)
+        {
+            if(ALSource->HrtfLod == HrtfLodPanned)
+            {
+                // Start the HRIR from the current panned gains, so it can
+                // step to the full HRTF response.
+                ALuint k;
+                for(k = 0;k < SRC_HISTORY_LENGTH;k++)
+                    HrtfState->History[0][k] = 0.0f;
+                for(k = 0;k < HRIR_LENGTH;k++)
+                {
+                    HrtfState->Values[0][k][0] = 0.0f;
+                    HrtfState->Values[0][k][1] = 0.0f;
+                    HrtfState->Coeffs[0][k][0] = 0.0f;
+                    HrtfState->Coeffs[0][k][1] = 0.0f;
+                    HrtfState->CoeffStep[k][0] = 0.0f;
+                    HrtfState->CoeffStep[k][1] = 0.0f;
+                }
+                HrtfState->Coeffs[0][0][0] = ALSource->Params.DryGains[0][FRONT_LEFT];
+                HrtfState->Coeffs[0][0][1] = ALSource->Params.DryGains[0][FRONT_RIGHT];
+                HrtfState->Delay[0][0] = 0;
+                HrtfState->Delay[0][1] = 0;
+                HrtfState->DelayStep[0] = 0;
+                HrtfState->DelayStep[1] = 0;
+                ALSource->HrtfCounter = 0;
+            }
+            if(ALSource->HrtfLod != HrtfLodFull)
+                HrtfFadeIn = AL_TRUE;
+            ALSource->HrtfLod = HrtfLodFull;
+        }
+        else if(ALSource->HrtfLod == HrtfLodFull)
+        {
+            ALSource->HrtfLod = HrtfLodFading;
+            HrtfFadeOut = AL_TRUE;
+        }
+        else if(ALSource->HrtfLod == HrtfLodFading)
+        {
+            // Once the HRIR has reached the panned response and the old taps
+            // are gone, the plain mixer produces the same output.
+            if(ALSource->HrtfCounter == 0 && HrtfValuesDrained(ALSource))
+                ALSource->HrtfLod = HrtfLodPanned;
+        }
+    }
+
+    if(HrtfState && ALSource->HrtfLod != HrtfLodPanned)
+    {
         ALSource->Params.DoMix = SelectHrtfMixer(Resampler);
+        ALSource->Params.DoMixPoint = SelectHrtfMixer(PointResampler);
+    }
     else
+    {
         ALSource->Params.DoMix = SelectMixer(Resampler);
+        ALSource->Params.DoMixPoint = SelectMixer(PointResampler);
+    }
 
-    if(Device->Hrtf)
+    if(HrtfState && ALSource->HrtfLod == HrtfLodFull)
     {
         // Use a binaural HRTF algorithm for stereo headphone playback
         ALfloat delta, ev = 0.0f, az = 0.0f;
@@ -711,17 +911,20 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
             // Calculate the normalized HRTF transition factor (delta).
             delta = CalcHrtfDelta(ALSource->Params.HrtfGain, DryGain,
                                   ALSource->Params.HrtfDir, Position);
+            // Fade all the way in when coming from the panned response.
+            if(HrtfFadeIn)
+                delta = 1.0f;
             // If the delta is large enough, get the moving HRIR target
             // coefficients, target delays, steppping values, and counter.
             if(delta > 0.001f)
             {
                 ALSource->HrtfCounter = GetMovingHrtfCoeffs(Device->Hrtf,
-                                          ev, az, DryGain, delta,
+                                          Device->HrtfCache, ev, az, DryGain, delta,
                                           ALSource->HrtfCounter,
-                                          ALSource->Params.HrtfCoeffs[0],
-                                          ALSource->Params.HrtfDelay[0],
-                                          ALSource->Params.HrtfCoeffStep,
-                                          ALSource->Params.HrtfDelayStep);
+                                          HrtfState->Coeffs[0],
+                                          HrtfState->Delay[0],
+                                          HrtfState->CoeffStep,
+                                          HrtfState->DelayStep);
                 ALSource->Params.HrtfGain = DryGain;
                 ALSource->Params.HrtfDir[0] = Position[0];
                 ALSource->Params.HrtfDir[1] = Position[1];
@@ -731,9 +934,10 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
         else
         {
             // Get the initial (static) HRIR coefficients and delays.
-            GetLerpedHrtfCoeffs(Device->Hrtf, ev, az, DryGain,
-                                ALSource->Params.HrtfCoeffs[0],
-                                ALSource->Params.HrtfDelay[0]);
+            GetLerpedHrtfCoeffs(Device->Hrtf, Device->HrtfCache,
+                                ev, az, DryGain,
+                                HrtfState->Coeffs[0],
+                                HrtfState->Delay[0]);
             ALSource->HrtfCounter = 0;
             ALSource->Params.HrtfGain = DryGain;
             ALSource->Params.HrtfDir[0] = Position[0];
@@ -777,6 +981,19 @@ ALvoid CalcSourceParams(ALsource *ALSource, const ALCcontext *ALContext)
             ALfloat gain = lerp(AmbientGain, ChannelGain[chan], DirGain);
             ALSource->Params.DryGains[0][chan] = DryGain * gain;
         }
+
+        if(HrtfState && ALSource->HrtfLod == HrtfLodFading)
+        {
+            // Step the HRTF mixer toward the panned gains over 15ms, following
+            // any gain changes during the fade, and check back next update to
+            // switch over.
+            ALuint count = maxu(ALSource->HrtfCounter, 1);
+            if(HrtfFadeOut)
+                count = maxu(fastf2u(Frequency*0.015f), 1);
+            SetPannedHrtfTarget(ALSource, ALSource->Params.DryGains[0][FRONT_LEFT],
+                                ALSource->Params.DryGains[0][FRONT_RIGHT], count);
+            ALSource->NeedsUpdate = AL_TRUE;
+        }
     }
     for(i = 0;i < NumSends;i++)
         ALSource->Params.Send[i].WetGain = WetGain[i];
@@ -918,6 +1135,150 @@ DECL_TEMPLATE(ALbyte)
 
 #undef DECL_TEMPLATE
 
+static ALvoid ProcessEffectSlot(ALCdevice *device, ALeffectslot *slot, ALuint SamplesToDo, ALboolean DeferUpdates)
+{
+    ALfloat peak = 0.0f;
+    ALuint i;
+
+    for(i = 0;i < SamplesToDo;i++)
+    {
+        slot->WetBuffer[i] += slot->ClickRemoval[0];
+        slot->ClickRemoval[0] -= slot->ClickRemoval[0] * (1.0f/256.0f);
+        peak = maxf(peak, aluFabs(slot->WetBuffer[i]));
+    }
+    slot->ClickRemoval[0] += slot->PendingClicks[0];
+    slot->PendingClicks[0] = 0.0f;
+
+    /* With no input and the effect's tail decayed below the silence
+     * threshold, there's nothing to hear. Let the slot sleep, skipping the
+     * effect (and the buffer clear, when it's already empty) until new input
+     * wakes it up. Pending updates are kept for then. */
+    if(peak <= EFFECT_SILENCE_THRESHOLD && slot->TailRemaining == 0)
+    {
+        if(peak > 0.0f)
+        {
+            for(i = 0;i < SamplesToDo;i++)
+                slot->WetBuffer[i] = 0.0f;
+        }
+        return;
+    }
+
+    if(!DeferUpdates && ExchangeInt(&slot->NeedsUpdate, AL_FALSE))
+        ALeffectState_Update(slot->EffectState, device, slot);
+
+    ALeffectState_Process(slot->EffectState, SamplesToDo,
+                          slot->WetBuffer, device->DryBuffer);
+
+    for(i = 0;i < SamplesToDo;i++)
+        slot->WetBuffer[i] = 0.0f;
+
+    if(peak > EFFECT_SILENCE_THRESHOLD)
+        slot->TailRemaining = ALeffectState_GetTailLength(slot->EffectState);
+    else
+        slot->TailRemaining -= minu(slot->TailRemaining, SamplesToDo);
+}
+
+/* Checks if two slots produce the same output given the same input, that is,
+ * they have the same gain and the same effect with the same parameters. The
+ * properties are compared one by one, since the structs may hold padding. */
+static ALboolean EffectSlotsMatch(const ALeffectslot *a, const ALeffectslot *b)
+{
+    const ALeffect *ea = &a->effect;
+    const ALeffect *eb = &b->effect;
+    ALuint i;
+
+    if(a->Gain != b->Gain || ea->type != eb->type)
+        return AL_FALSE;
+
+    switch(ea->type)
+    {
+        case AL_EFFECT_REVERB:
+        case AL_EFFECT_EAXREVERB:
+            if(ea->Reverb.Density != eb->Reverb.Density ||
+               ea->Reverb.Diffusion != eb->Reverb.Diffusion ||
+               ea->Reverb.Gain != eb->Reverb.Gain ||
+               ea->Reverb.GainHF != eb->Reverb.GainHF ||
+               ea->Reverb.DecayTime != eb->Reverb.DecayTime ||
+               ea->Reverb.DecayHFRatio != eb->Reverb.DecayHFRatio ||
+               ea->Reverb.ReflectionsGain != eb->Reverb.ReflectionsGain ||
+               ea->Reverb.ReflectionsDelay != eb->Reverb.ReflectionsDelay ||
+               ea->Reverb.LateReverbGain != eb->Reverb.LateReverbGain ||
+               ea->Reverb.LateReverbDelay != eb->Reverb.LateReverbDelay ||
+               ea->Reverb.AirAbsorptionGainHF != eb->Reverb.AirAbsorptionGainHF ||
+               ea->Reverb.RoomRolloffFactor != eb->Reverb.RoomRolloffFactor ||
+               ea->Reverb.DecayHFLimit != eb->Reverb.DecayHFLimit ||
+               ea->Reverb.GainLF != eb->Reverb.GainLF ||
+               ea->Reverb.DecayLFRatio != eb->Reverb.DecayLFRatio ||
+               ea->Reverb.EchoTime != eb->Reverb.EchoTime ||
+               ea->Reverb.EchoDepth != eb->Reverb.EchoDepth ||
+               ea->Reverb.ModulationTime != eb->Reverb.ModulationTime ||
+               ea->Reverb.ModulationDepth != eb->Reverb.ModulationDepth ||
+               ea->Reverb.HFReference != eb->Reverb.HFReference ||
+               ea->Reverb.LFReference != eb->Reverb.LFReference)
+                return AL_FALSE;
+            for(i = 0;i < 3;i++)
+            {
+                if(ea->Reverb.ReflectionsPan[i] != eb->Reverb.ReflectionsPan[i] ||
+                   ea->Reverb.LateReverbPan[i] != eb->Reverb.LateReverbPan[i])
+                    return AL_FALSE;
+            }
+            return AL_TRUE;
+        case AL_EFFECT_ECHO:
+            return ea->Echo.Delay == eb->Echo.Delay &&
+                   ea->Echo.LRDelay == eb->Echo.LRDelay &&
+                   ea->Echo.Damping == eb->Echo.Damping &&
+                   ea->Echo.Feedback == eb->Echo.Feedback &&
+                   ea->Echo.Spread == eb->Echo.Spread;
+        case AL_EFFECT_RING_MODULATOR:
+            return ea->Modulator.Frequency == eb->Modulator.Frequency &&
+                   ea->Modulator.HighPassCutoff == eb->Modulator.HighPassCutoff &&
+                   ea->Modulator.Waveform == eb->Modulator.Waveform;
+        case AL_EFFECT_DEDICATED_DIALOGUE:
+        case AL_EFFECT_DEDICATED_LOW_FREQUENCY_EFFECT:
+            return ea->Dedicated.Gain == eb->Dedicated.Gain;
+    }
+    return AL_TRUE;
+}
+
+/* Passes the input of the slot at 'cur' on to the first slot before it with a
+ * matching effect, so the effect is processed once for both. This only
+ * happens after the slot's own tail has finished, so nothing gets cut off.
+ * Returns AL_TRUE if the input was handed off. */
+static ALboolean MergeEffectSlot(ALeffectslot **first, ALeffectslot **cur, ALuint SamplesToDo, ALboolean DeferUpdates)
+{
+    ALeffectslot *src = *cur;
+    ALeffectslot *dst = NULL;
+    ALuint i;
+
+    if(src->TailRemaining != 0 || (DeferUpdates && src->NeedsUpdate))
+        return AL_FALSE;
+
+    for(;first != cur;first++)
+    {
+        // A slot with a deferred update is still running its old parameters
+        if(DeferUpdates && (*first)->NeedsUpdate)
+            continue;
+        if(EffectSlotsMatch(*first, src))
+        {
+            dst = *first;
+            break;
+        }
+    }
+    if(!dst)
+        return AL_FALSE;
+
+    for(i = 0;i < SamplesToDo;i++)
+    {
+        dst->WetBuffer[i] += src->WetBuffer[i] + src->ClickRemoval[0];
+        src->ClickRemoval[0] -= src->ClickRemoval[0] * (1.0f/256.0f);
+        src->WetBuffer[i] = 0.0f;
+    }
+    src->ClickRemoval[0] += src->PendingClicks[0];
+    src->PendingClicks[0] = 0.0f;
+
+    return AL_TRUE;
+}
+
 ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
 {
     ALuint SamplesToDo;
@@ -969,26 +1330,24 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
             /* effect slot processing */
             slot = ctx->ActiveEffectSlots;
             slot_end = slot + ctx->ActiveEffectSlotCount;
-            while(slot != slot_end)
+            if(CoalesceEffectSlots)
             {
-                for(c = 0;c < SamplesToDo;c++)
+                /* Go backwards, so a slot can pass its input on to an earlier
+                 * matching slot before that one gets processed. */
+                while(slot_end != slot)
                 {
-                    (*slot)->WetBuffer[c] += (*slot)->ClickRemoval[0];
-                    (*slot)->ClickRemoval[0] -= (*slot)->ClickRemoval[0] * (1.0f/256.0f);
+                    slot_end--;
+                    if(!MergeEffectSlot(slot, slot_end, SamplesToDo, DeferUpdates))
+                        ProcessEffectSlot(device, *slot_end, SamplesToDo, DeferUpdates);
+                }
+            }
+            else
+            {
+                while(slot != slot_end)
+                {
+                    ProcessEffectSlot(device, *slot, SamplesToDo, DeferUpdates);
+                    slot++;
                 }
-                (*slot)->ClickRemoval[0] += (*slot)->PendingClicks[0];
-                (*slot)->PendingClicks[0] = 0.0f;
-
-                if(!DeferUpdates && ExchangeInt(&(*slot)->NeedsUpdate, AL_FALSE))
-                    ALeffectState_Update((*slot)->EffectState, device, *slot);
-
-                ALeffectState_Process((*slot)->EffectState, SamplesToDo,
-                                      (*slot)->WetBuffer, device->DryBuffer);
-
-                for(i = 0;i < SamplesToDo;i++)
-                    (*slot)->WetBuffer[i] = 0.0f;
-
-                slot++;
             }
 
             ctx = ctx->next;
@@ -996,24 +1355,7 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
 
         slot = &device->DefaultSlot;
         if(*slot != NULL)
-        {
-            for(c = 0;c < SamplesToDo;c++)
-            {
-                (*slot)->WetBuffer[c] += (*slot)->ClickRemoval[0];
-                (*slot)->ClickRemoval[0] -= (*slot)->ClickRemoval[0] * (1.0f/256.0f);
-            }
-            (*slot)->ClickRemoval[0] += (*slot)->PendingClicks[0];
-            (*slot)->PendingClicks[0] = 0.0f;
-
-            if(ExchangeInt(&(*slot)->NeedsUpdate, AL_FALSE))
-                ALeffectState_Update((*slot)->EffectState, device, *slot);
-
-            ALeffectState_Process((*slot)->EffectState, SamplesToDo,
-                                  (*slot)->WetBuffer, device->DryBuffer);
-
-            for(i = 0;i < SamplesToDo;i++)
-                (*slot)->WetBuffer[i] = 0.0f;
-        }
+            ProcessEffectSlot(device, *slot, SamplesToDo, AL_FALSE);
         UnlockDevice(device);
 
         //Post processing loop
@@ -1027,7 +1369,7 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
             device->ClickRemoval[FRONT_CENTER] += device->PendingClicks[FRONT_CENTER];
             device->PendingClicks[FRONT_CENTER] = 0.0f;
         }
-        else if(device->FmtChans == DevFmtStereo)
+        else if(device->FmtChans == DevFmtStereo && !device->HrtfBus)
         {
             /* Assumes the first two channels are FRONT_LEFT and FRONT_RIGHT */
             for(i = 0;i < SamplesToDo;i++)
@@ -1064,6 +1406,8 @@ ALvoid aluMixData(ALCdevice *device, ALvoid *buffer, ALsizei size)
                 device->ClickRemoval[c] += device->PendingClicks[c];
                 device->PendingClicks[c] = 0.0f;
             }
+            if(device->HrtfBus)
+                ApplyHrtfBus(device->HrtfBus, device->DryBuffer, SamplesToDo);
         }
 
         if(buffer)
@@ -80,16 +80,24 @@ static ALvoid DedicatedProcess(ALeffectState *effect, ALuint SamplesToDo, const
     const ALfloat *gains = state->gains;
     ALuint i, s;
 
-    for(i = 0;i < SamplesToDo;i++)
+    for(s = 0;s < MAXCHANNELS;s++)
     {
-        ALfloat sample;
+        const ALfloat gain = gains[s];
 
-        sample = SamplesIn[i];
-        for(s = 0;s < MAXCHANNELS;s++)
-            SamplesOut[i][s] = sample * gains[s];
+        // Dialogue only feeds the channels it's panned to, and LFE only one
+        if(gain == 0.0f)
+            continue;
+        for(i = 0;i < SamplesToDo;i++)
+            SamplesOut[i][s] += SamplesIn[i] * gain;
     }
 }
 
+static ALuint DedicatedGetTailLength(ALeffectState *effect)
+{
+    (void)effect;
+    return 0;
+}
+
 ALeffectState *DedicatedCreate(void)
 {
     ALdedicatedState *state;
@@ -103,6 +111,7 @@ ALeffectState *DedicatedCreate(void)
     state->state.DeviceUpdate = DedicatedDeviceUpdate;
     state->state.Update = DedicatedUpdate;
     state->state.Process = DedicatedProcess;
+    state->state.GetTailLength = DedicatedGetTailLength;
 
     for(s = 0;s < MAXCHANNELS;s++)
         state->gains[s] = 0.0f;
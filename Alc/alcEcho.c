@@ -30,6 +30,10 @@
 #include "alu.h"
 
 
+// The maximum number of samples processed at once; the taps are read out into
+// local buffers of this size.
+#define MAX_UPDATE_SAMPLES 256
+
 typedef struct ALechoState {
     // Must be first in all effects!
     ALeffectState state;
@@ -45,9 +49,15 @@ typedef struct ALechoState {
     ALuint Offset;
     /* The panning gains for the two taps */
     ALfloat Gain[2][MAXCHANNELS];
+    /* The output channels with a non-zero gain for either tap */
+    enum Channel Chans[MAXCHANNELS];
+    ALuint NumChans;
 
     ALfloat FeedGain;
 
+    // Samples for the feedback to die away below the silence threshold
+    ALuint TailLength;
+
     FILTER iirFilter;
     ALfloat history[2];
 } ALechoState;
@@ -96,7 +106,7 @@ static ALvoid EchoUpdate(ALeffectState *effect, ALCdevice *Device, const ALeffec
     ALuint frequency = Device->Frequency;
     ALfloat dirGain, ambientGain;
     const ALfloat *ChannelGain;
-    ALfloat lrpan, cw, g, gain;
+    ALfloat lrpan, cw, g, gain, loops;
     ALuint i, pos;
 
     state->Tap[0].delay = fastf2u(Slot->effect.Echo.Delay * frequency) + 1;
@@ -107,6 +117,14 @@ static ALvoid EchoUpdate(ALeffectState *effect, ALCdevice *Device, const ALeffec
 
     state->FeedGain = Slot->effect.Echo.Feedback;
 
+    // Every pass through the second tap attenuates what's left in the line by
+    // the feedback gain, so the tail lasts as many passes as it takes for that
+    // to fall below the silence threshold
+    loops = 1.0f;
+    if(state->FeedGain > EFFECT_SILENCE_THRESHOLD)
+        loops += aluLog10(EFFECT_SILENCE_THRESHOLD) / aluLog10(state->FeedGain);
+    state->TailLength = fastf2u(loops * state->Tap[1].delay);
+
     cw = aluCos(F_PI*2.0f * LOWPASSFREQREF / frequency);
     g = 1.0f - Slot->effect.Echo.Damping;
     state->iirFilter.coeff = lpCoeffCalc(g, cw);
@@ -140,36 +158,88 @@ static ALvoid EchoUpdate(ALeffectState *effect, ALCdevice *Device, const ALeffec
         enum Channel chan = Device->Speaker2Chan[i];
         state->Gain[1][chan] = lerp(ambientGain, ChannelGain[chan], dirGain) * gain;
     }
+
+    state->NumChans = 0;
+    for(i = 0;i < MAXCHANNELS;i++)
+    {
+        if(state->Gain[0][i] != 0.0f || state->Gain[1][i] != 0.0f)
+            state->Chans[state->NumChans++] = i;
+    }
 }
 
 static ALvoid EchoProcess(ALeffectState *effect, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
 {
     ALechoState *state = (ALechoState*)effect;
+    ALfloat *line = state->SampleBuffer;
     const ALuint mask = state->BufferLength-1;
     const ALuint tap1 = state->Tap[0].delay;
     const ALuint tap2 = state->Tap[1].delay;
+    const ALuint NumChans = state->NumChans;
+    ALfloat taps[2][MAX_UPDATE_SAMPLES];
+    ALfloat gain1[MAXCHANNELS], gain2[MAXCHANNELS];
+    enum Channel chans[MAXCHANNELS];
     ALuint offset = state->Offset;
-    ALfloat smp;
-    ALuint i, k;
+    ALuint base, todo, i, k;
+    // Work on a local copy of the filter, so its history can stay in
+    // registers instead of going through memory every sample
+    struct {
+        FILTER iir;
+        ALfloat history[2];
+    } damping;
 
-    for(i = 0;i < SamplesToDo;i++,offset++)
+    damping.iir.coeff = state->iirFilter.coeff;
+    damping.iir.history[0] = state->iirFilter.history[0];
+    damping.iir.history[1] = state->iirFilter.history[1];
+
+    for(k = 0;k < NumChans;k++)
+    {
+        chans[k] = state->Chans[k];
+        gain1[k] = state->Gain[0][chans[k]];
+        gain2[k] = state->Gain[1][chans[k]];
+    }
+
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        /* First tap */
-        smp = state->SampleBuffer[(offset-tap1) & mask];
-        for(k = 0;k < MAXCHANNELS;k++)
-            SamplesOut[i][k] += smp * state->Gain[0][k];
+        // The block can't be longer than the shortest tap, so the taps only
+        // read samples written before the block started.
+        todo = minu(SamplesToDo-base, MAX_UPDATE_SAMPLES);
+        todo = minu(todo, tap1);
 
-        /* Second tap */
-        smp = state->SampleBuffer[(offset-tap2) & mask];
-        for(k = 0;k < MAXCHANNELS;k++)
-            SamplesOut[i][k] += smp * state->Gain[1][k];
+        for(i = 0;i < todo;i++)
+        {
+            taps[0][i] = line[(offset+i-tap1) & mask];
+            taps[1][i] = line[(offset+i-tap2) & mask];
+        }
 
         // Apply damping and feedback gain to the second tap, and mix in the
-        // new sample
-        smp = lpFilter2P(&state->iirFilter, 0, smp+SamplesIn[i]);
-        state->SampleBuffer[offset&mask] = smp * state->FeedGain;
+        // new samples
+        for(i = 0;i < todo;i++)
+        {
+            ALfloat smp = lpFilter2P(&damping.iir, 0, taps[1][i]+SamplesIn[base+i]);
+            line[(offset+i)&mask] = smp * state->FeedGain;
+        }
+        offset += todo;
+
+        // Mix both taps into the channels they're panned to
+        for(i = 0;i < todo;i++)
+        {
+            ALfloat *RESTRICT out = SamplesOut[base+i];
+            for(k = 0;k < NumChans;k++)
+            {
+                out[chans[k]] += taps[0][i] * gain1[k];
+                out[chans[k]] += taps[1][i] * gain2[k];
+            }
+        }
     }
     state->Offset = offset;
+    state->iirFilter.history[0] = damping.iir.history[0];
+    state->iirFilter.history[1] = damping.iir.history[1];
+}
+
+static ALuint EchoGetTailLength(ALeffectState *effect)
+{
+    ALechoState *state = (ALechoState*)effect;
+    return state->TailLength;
 }
 
 ALeffectState *EchoCreate(void)
@@ -184,6 +254,7 @@ ALeffectState *EchoCreate(void)
     state->state.DeviceUpdate = EchoDeviceUpdate;
     state->state.Update = EchoUpdate;
     state->state.Process = EchoProcess;
+    state->state.GetTailLength = EchoGetTailLength;
 
     state->BufferLength = 0;
     state->SampleBuffer = NULL;
@@ -191,6 +262,8 @@ ALeffectState *EchoCreate(void)
     state->Tap[0].delay = 0;
     state->Tap[1].delay = 0;
     state->Offset = 0;
+    state->TailLength = 0;
+    state->NumChans = 0;
 
     state->iirFilter.coeff = 0.0f;
     state->iirFilter.history[0] = 0.0f;
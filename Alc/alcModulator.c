@@ -44,6 +44,9 @@ typedef struct ALmodulatorState {
     ALuint step;
 
     ALfloat Gain[MAXCHANNELS];
+    /* The output channels with a non-zero gain */
+    enum Channel Chans[MAXCHANNELS];
+    ALuint NumChans;
 
     FILTER iirFilter;
     ALfloat history[1];
@@ -53,10 +56,8 @@ typedef struct ALmodulatorState {
 #define WAVEFORM_FRACONE   (1<<WAVEFORM_FRACBITS)
 #define WAVEFORM_FRACMASK  (WAVEFORM_FRACONE-1)
 
-static __inline ALfloat Sin(ALuint index)
-{
-    return aluSin(index * (F_PI*2.0f / WAVEFORM_FRACONE));
-}
+// The maximum number of samples processed at once
+#define MAX_UPDATE_SAMPLES 256
 
 static __inline ALfloat Saw(ALuint index)
 {
@@ -83,36 +84,54 @@ static __inline ALfloat hpFilter1P(FILTER *iir, ALuint offset, ALfloat input)
 
 
 #define DECL_TEMPLATE(func)                                                   \
-static void Process##func(ALmodulatorState *state, ALuint SamplesToDo,        \
-  const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])               \
+static void Modulate##func(ALmodulatorState *state, ALuint todo,              \
+  const ALfloat *RESTRICT in, ALfloat *RESTRICT out)                          \
 {                                                                             \
     const ALuint step = state->step;                                          \
     ALuint index = state->index;                                              \
-    ALfloat samp;                                                             \
-    ALuint i, k;                                                              \
+    ALuint i;                                                                 \
                                                                               \
-    for(i = 0;i < SamplesToDo;i++)                                            \
+    for(i = 0;i < todo;i++)                                                   \
     {                                                                         \
-        samp = SamplesIn[i];                                                  \
-                                                                              \
         index += step;                                                        \
         index &= WAVEFORM_FRACMASK;                                           \
-        samp *= func(index);                                                  \
-                                                                              \
-        samp = hpFilter1P(&state->iirFilter, 0, samp);                        \
-                                                                              \
-        for(k = 0;k < MAXCHANNELS;k++)                                        \
-            SamplesOut[i][k] += state->Gain[k] * samp;                        \
+        out[i] = in[i] * func(index);                                         \
     }                                                                         \
     state->index = index;                                                     \
 }
 
-DECL_TEMPLATE(Sin)
 DECL_TEMPLATE(Saw)
 DECL_TEMPLATE(Square)
 
 #undef DECL_TEMPLATE
 
+/* The sinusoid is generated with a phasor, rotated by the step angle each
+ * sample. It's started from the exact phase for each block, so rounding
+ * errors don't get the chance to build up. */
+static void ModulateSin(ALmodulatorState *state, ALuint todo,
+                        const ALfloat *RESTRICT in, ALfloat *RESTRICT out)
+{
+    const ALfloat scale = F_PI*2.0f / WAVEFORM_FRACONE;
+    const ALuint step = state->step;
+    ALuint index = (state->index+step) & WAVEFORM_FRACMASK;
+    ALfloat stepcos = aluCos(step * scale);
+    ALfloat stepsin = aluSin(step * scale);
+    ALfloat re = aluCos(index * scale);
+    ALfloat im = aluSin(index * scale);
+    ALfloat tmp;
+    ALuint i;
+
+    for(i = 0;i < todo;i++)
+    {
+        out[i] = in[i] * im;
+
+        tmp = re*stepcos - im*stepsin;
+        im  = im*stepcos + re*stepsin;
+        re  = tmp;
+    }
+    state->index = (state->index + step*todo) & WAVEFORM_FRACMASK;
+}
+
 
 static ALvoid ModulatorDestroy(ALeffectState *effect)
 {
@@ -158,26 +177,74 @@ static ALvoid ModulatorUpdate(ALeffectState *effect, ALCdevice *Device, const AL
         enum Channel chan = Device->Speaker2Chan[index];
         state->Gain[chan] = gain;
     }
+
+    state->NumChans = 0;
+    for(index = 0;index < MAXCHANNELS;index++)
+    {
+        if(state->Gain[index] != 0.0f)
+            state->Chans[state->NumChans++] = index;
+    }
 }
 
 static ALvoid ModulatorProcess(ALeffectState *effect, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
 {
     ALmodulatorState *state = (ALmodulatorState*)effect;
-
-    switch(state->Waveform)
+    const ALuint NumChans = state->NumChans;
+    ALfloat samples[MAX_UPDATE_SAMPLES];
+    ALuint base, todo, i, k;
+    // Work on a local copy of the filter, so its history can stay in a
+    // register instead of going through memory every sample
+    struct {
+        FILTER iir;
+        ALfloat history[1];
+    } highpass;
+
+    highpass.iir.coeff = state->iirFilter.coeff;
+    highpass.iir.history[0] = state->iirFilter.history[0];
+
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        case SINUSOID:
-            ProcessSin(state, SamplesToDo, SamplesIn, SamplesOut);
-            break;
+        todo = minu(SamplesToDo-base, MAX_UPDATE_SAMPLES);
+
+        switch(state->Waveform)
+        {
+            case SINUSOID:
+                ModulateSin(state, todo, &SamplesIn[base], samples);
+                break;
+
+            case SAWTOOTH:
+                ModulateSaw(state, todo, &SamplesIn[base], samples);
+                break;
+
+            case SQUARE:
+                ModulateSquare(state, todo, &SamplesIn[base], samples);
+                break;
+        }
+
+        for(i = 0;i < todo;i++)
+            samples[i] = hpFilter1P(&highpass.iir, 0, samples[i]);
+
+        for(k = 0;k < NumChans;k++)
+        {
+            const enum Channel chan = state->Chans[k];
+            const ALfloat gain = state->Gain[chan];
+
+            for(i = 0;i < todo;i++)
+                SamplesOut[base+i][chan] += samples[i] * gain;
+        }
+    }
+    state->iirFilter.history[0] = highpass.iir.history[0];
+}
 
-        case SAWTOOTH:
-            ProcessSaw(state, SamplesToDo, SamplesIn, SamplesOut);
-            break;
+static ALuint ModulatorGetTailLength(ALeffectState *effect)
+{
+    ALmodulatorState *state = (ALmodulatorState*)effect;
+    ALfloat a = state->iirFilter.coeff;
 
-        case SQUARE:
-            ProcessSquare(state, SamplesToDo, SamplesIn, SamplesOut);
-            break;
-    }
+    // Only the high-pass filter's history outlasts the input
+    if(a <= EFFECT_SILENCE_THRESHOLD || a >= 1.0f)
+        return 0;
+    return fastf2u(aluLog10(EFFECT_SILENCE_THRESHOLD) / aluLog10(a)) + 1;
 }
 
 ALeffectState *ModulatorCreate(void)
@@ -192,9 +259,11 @@ ALeffectState *ModulatorCreate(void)
     state->state.DeviceUpdate = ModulatorDeviceUpdate;
     state->state.Update = ModulatorUpdate;
     state->state.Process = ModulatorProcess;
+    state->state.GetTailLength = ModulatorGetTailLength;
 
     state->index = 0;
     state->step = 1;
+    state->NumChans = 0;
 
     state->iirFilter.coeff = 0.0f;
     state->iirFilter.history[0] = 0.0f;
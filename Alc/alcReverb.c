@@ -154,6 +154,25 @@ typedef struct ALverbState {
     // The current read offset for all delay lines.
     ALuint Offset;
 
+    // Samples for the reverb to decay below the silence threshold after its
+    // input stops.
+    ALuint TailLength;
+
+    struct {
+        // The reverb runs at the device rate divided by 1<<Shift.
+        ALuint    Shift;
+
+        // Decimator state: the number of input samples summed so far for the
+        // next reduced-rate sample, and their sum.
+        ALuint    Count;
+        ALfloat   Sum;
+
+        // The last two reduced-rate outputs, interpolated between to restore
+        // the device rate.
+        ALfloat   Early[2][4];
+        ALfloat   Late[2][4];
+    } Rate;
+
     // The gain for each output channel (non-EAX path only; aliased from
     // Late.PanGain)
     ALfloat *Gain;
@@ -167,6 +186,11 @@ ALfloat ReverbBoost = 1.0f;
 /* Specifies whether to use a standard reverb effect in place of EAX reverb */
 ALboolean EmulateEAXReverb = AL_FALSE;
 
+/* This is a user config option for running the reverb at a reduced sample
+ * rate (the device rate divided by 1<<ReverbRateShift) to save processing.
+ */
+ALuint ReverbRateShift = 0;
+
 /* This coefficient is used to define the maximum frequency range controlled
  * by the modulation depth.  The current value of 0.1 will allow it to swing
  * from 0.9x to 1.1x.  This value must be below 1.  At 1 it will cause the
@@ -217,6 +241,11 @@ static const ALfloat LATE_LINE_LENGTH[4] =
 // effect's density parameter (inverted for some reason) and this multiplier.
 static const ALfloat LATE_LINE_MULTIPLIER = 4.0f;
 
+// The reverb is processed in blocks of up to this many samples at a time.
+// Each stage runs over a whole block before the next one starts, so any line
+// that is fed a block before being read back needs room for one extra block.
+#define MAX_UPDATE_SAMPLES 256
+
 
 // Basic delay line input/output routines.
 static __inline ALfloat DelayLineOut(DelayLine *Delay, ALuint offset)
@@ -229,134 +258,178 @@ static __inline ALvoid DelayLineIn(DelayLine *Delay, ALuint offset, ALfloat in)
     Delay->Line[offset&Delay->Mask] = in;
 }
 
-// Attenuated delay line output routine.
-static __inline ALfloat AttenuatedDelayLineOut(DelayLine *Delay, ALuint offset, ALfloat coeff)
+// Block delay line input/output routines.  A run of samples is split where
+// it wraps around the end of the line, so the inner loops work on contiguous
+// memory without masking each access.
+static __inline ALvoid DelayLineOutBlock(const DelayLine *Delay, ALuint offset, ALfloat *RESTRICT out, ALuint todo)
 {
-    return coeff * Delay->Line[offset&Delay->Mask];
+    while(todo > 0)
+    {
+        const ALuint pos = offset&Delay->Mask;
+        const ALuint count = minu(todo, Delay->Mask+1 - pos);
+        const ALfloat *RESTRICT line = &Delay->Line[pos];
+        ALuint i;
+
+        for(i = 0;i < count;i++)
+            out[i] = line[i];
+
+        offset += count;
+        out += count;
+        todo -= count;
+    }
 }
 
-// Basic attenuated all-pass input/output routine.
-static __inline ALfloat AllpassInOut(DelayLine *Delay, ALuint outOffset, ALuint inOffset, ALfloat in, ALfloat feedCoeff, ALfloat coeff)
+static __inline ALvoid DelayLineInBlock(DelayLine *Delay, ALuint offset, const ALfloat *RESTRICT in, ALuint todo)
 {
-    ALfloat out, feed;
+    while(todo > 0)
+    {
+        const ALuint pos = offset&Delay->Mask;
+        const ALuint count = minu(todo, Delay->Mask+1 - pos);
+        ALfloat *RESTRICT line = &Delay->Line[pos];
+        ALuint i;
 
-    out = DelayLineOut(Delay, outOffset);
-    feed = feedCoeff * in;
-    DelayLineIn(Delay, inOffset, (feedCoeff * (out - feed)) + in);
+        for(i = 0;i < count;i++)
+            line[i] = in[i];
 
-    // The time-based attenuation is only applied to the delay output to
-    // keep it from affecting the feed-back path (which is already controlled
-    // by the all-pass feed coefficient).
-    return (coeff * out) - feed;
+        offset += count;
+        in += count;
+        todo -= count;
+    }
 }
 
-// Given an input sample, this function produces modulation for the late
-// reverb.
-static __inline ALfloat EAXModulation(ALverbState *State, ALfloat in)
+// Basic attenuated all-pass input/output routine, applied in-place over a
+// block of samples.  The block must not be longer than the all-pass delay,
+// so every sample read was written by a previous block.
+static ALvoid AllpassInOutBlock(DelayLine *Delay, ALuint offset, ALuint delay, ALfloat *RESTRICT inout, ALuint todo, ALfloat feedCoeff, ALfloat coeff)
 {
-    ALfloat sinus, frac;
-    ALuint offset;
-    ALfloat out0, out1;
+    ALfloat line[MAX_UPDATE_SAMPLES];
+    ALfloat out, feed;
+    ALuint i;
 
-    // Calculate the sinus rythm (dependent on modulation time and the
-    // sampling rate).  The center of the sinus is moved to reduce the delay
-    // of the effect when the time or depth are low.
-    sinus = 1.0f - aluCos(F_PI*2.0f * State->Mod.Index / State->Mod.Range);
-
-    // The depth determines the range over which to read the input samples
-    // from, so it must be filtered to reduce the distortion caused by even
-    // small parameter changes.
-    State->Mod.Filter = lerp(State->Mod.Filter, State->Mod.Depth,
-                             State->Mod.Coeff);
-
-    // Calculate the read offset and fraction between it and the next sample.
-    frac   = (1.0f + (State->Mod.Filter * sinus));
-    offset = fastf2u(frac);
-    frac  -= offset;
-
-    // Get the two samples crossed by the offset, and feed the delay line
-    // with the next input sample.
-    out0 = DelayLineOut(&State->Mod.Delay, State->Offset - offset);
-    out1 = DelayLineOut(&State->Mod.Delay, State->Offset - offset - 1);
-    DelayLineIn(&State->Mod.Delay, State->Offset, in);
-
-    // Step the modulation index forward, keeping it bound to its range.
-    State->Mod.Index = (State->Mod.Index + 1) % State->Mod.Range;
-
-    // The output is obtained by linearly interpolating the two samples that
-    // were acquired above.
-    return lerp(out0, out1, frac);
+    DelayLineOutBlock(Delay, offset - delay, line, todo);
+    for(i = 0;i < todo;i++)
+    {
+        out = line[i];
+        feed = feedCoeff * inout[i];
+        line[i] = (feedCoeff * (out - feed)) + inout[i];
+
+        // The time-based attenuation is only applied to the delay output to
+        // keep it from affecting the feed-back path (which is already
+        // controlled by the all-pass feed coefficient).
+        inout[i] = (coeff * out) - feed;
+    }
+    DelayLineInBlock(Delay, offset, line, todo);
 }
 
-// Delay line output routine for early reflections.
-static __inline ALfloat EarlyDelayLineOut(ALverbState *State, ALuint index)
+// Given a block of input samples, this function produces modulation for the
+// late reverb.
+static ALvoid EAXModulation(ALverbState *State, ALuint todo, ALfloat *RESTRICT inout)
 {
-    return AttenuatedDelayLineOut(&State->Early.Delay[index],
-                                  State->Offset - State->Early.Offset[index],
-                                  State->Early.Coeff[index]);
-}
+    ALfloat sinus, frac;
+    ALuint offset, i;
+    ALfloat out0, out1;
 
-// Given an input sample, this function produces four-channel output for the
-// early reflections.
-static __inline ALvoid EarlyReflection(ALverbState *State, ALfloat in, ALfloat *out)
-{
-    ALfloat d[4], v, f[4];
-
-    // Obtain the decayed results of each early delay line.
-    d[0] = EarlyDelayLineOut(State, 0);
-    d[1] = EarlyDelayLineOut(State, 1);
-    d[2] = EarlyDelayLineOut(State, 2);
-    d[3] = EarlyDelayLineOut(State, 3);
-
-    /* The following uses a lossless scattering junction from waveguide
-     * theory.  It actually amounts to a householder mixing matrix, which
-     * will produce a maximally diffuse response, and means this can probably
-     * be considered a simple feed-back delay network (FDN).
-     *          N
-     *         ---
-     *         \
-     * v = 2/N /   d_i
-     *         ---
-     *         i=1
-     */
-    v = (d[0] + d[1] + d[2] + d[3]) * 0.5f;
-    // The junction is loaded with the input here.
-    v += in;
-
-    // Calculate the feed values for the delay lines.
-    f[0] = v - d[0];
-    f[1] = v - d[1];
-    f[2] = v - d[2];
-    f[3] = v - d[3];
-
-    // Re-feed the delay lines.
-    DelayLineIn(&State->Early.Delay[0], State->Offset, f[0]);
-    DelayLineIn(&State->Early.Delay[1], State->Offset, f[1]);
-    DelayLineIn(&State->Early.Delay[2], State->Offset, f[2]);
-    DelayLineIn(&State->Early.Delay[3], State->Offset, f[3]);
-
-    // Output the results of the junction for all four channels.
-    out[0] = State->Early.Gain * f[0];
-    out[1] = State->Early.Gain * f[1];
-    out[2] = State->Early.Gain * f[2];
-    out[3] = State->Early.Gain * f[3];
-}
+    // Feed the delay line with the whole block first.  The modulated read
+    // offset is always at least one sample behind, and the line has room for
+    // a full update, so this doesn't disturb the samples still to be read.
+    DelayLineInBlock(&State->Mod.Delay, State->Offset, inout, todo);
 
-// All-pass input/output routine for late reverb.
-static __inline ALfloat LateAllPassInOut(ALverbState *State, ALuint index, ALfloat in)
-{
-    return AllpassInOut(&State->Late.ApDelay[index],
-                        State->Offset - State->Late.ApOffset[index],
-                        State->Offset, in, State->Late.ApFeedCoeff,
-                        State->Late.ApCoeff[index]);
+    for(i = 0;i < todo;i++)
+    {
+        // Calculate the sinus rythm (dependent on modulation time and the
+        // sampling rate).  The center of the sinus is moved to reduce the
+        // delay of the effect when the time or depth are low.
+        sinus = 1.0f - aluCos(F_PI*2.0f * State->Mod.Index / State->Mod.Range);
+
+        // The depth determines the range over which to read the input
+        // samples from, so it must be filtered to reduce the distortion
+        // caused by even small parameter changes.
+        State->Mod.Filter = lerp(State->Mod.Filter, State->Mod.Depth,
+                                 State->Mod.Coeff);
+
+        // Calculate the read offset and fraction between it and the next
+        // sample.
+        frac   = (1.0f + (State->Mod.Filter * sinus));
+        offset = fastf2u(frac);
+        frac  -= offset;
+
+        // Get the two samples crossed by the offset.
+        out0 = DelayLineOut(&State->Mod.Delay, State->Offset+i - offset);
+        out1 = DelayLineOut(&State->Mod.Delay, State->Offset+i - offset - 1);
+
+        // Step the modulation index forward, keeping it bound to its range.
+        State->Mod.Index = (State->Mod.Index + 1) % State->Mod.Range;
+
+        // The output is obtained by linearly interpolating the two samples
+        // that were acquired above.
+        inout[i] = lerp(out0, out1, frac);
+    }
 }
 
-// Delay line output routine for late reverb.
-static __inline ALfloat LateDelayLineOut(ALverbState *State, ALuint index)
+// Given a block of input samples, this function produces four-channel output
+// for the early reflections.
+static ALvoid EarlyReflection(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT out)[MAX_UPDATE_SAMPLES])
 {
-    return AttenuatedDelayLineOut(&State->Late.Delay[index],
-                                  State->Offset - State->Late.Offset[index],
-                                  State->Late.Coeff[index]);
+    ALfloat d[4], v;
+    ALuint base, count, offset;
+    ALuint index, i;
+
+    for(base = 0;base < todo;base += count)
+    {
+        // The shortest line bounds how many samples can be read before the
+        // feed-back written in this pass would be needed.
+        count = minu(todo-base, maxu(State->Early.Offset[0], 1));
+        offset = State->Offset + base;
+
+        // Obtain the results of each early delay line.
+        for(index = 0;index < 4;index++)
+            DelayLineOutBlock(&State->Early.Delay[index],
+                              offset - State->Early.Offset[index],
+                              &out[index][base], count);
+
+        for(i = base;i < base+count;i++)
+        {
+            // Apply the decay to each line's output.
+            d[0] = State->Early.Coeff[0] * out[0][i];
+            d[1] = State->Early.Coeff[1] * out[1][i];
+            d[2] = State->Early.Coeff[2] * out[2][i];
+            d[3] = State->Early.Coeff[3] * out[3][i];
+
+            /* The following uses a lossless scattering junction from
+             * waveguide theory.  It actually amounts to a householder mixing
+             * matrix, which will produce a maximally diffuse response, and
+             * means this can probably be considered a simple feed-back delay
+             * network (FDN).
+             *          N
+             *         ---
+             *         \
+             * v = 2/N /   d_i
+             *         ---
+             *         i=1
+             */
+            v = (d[0] + d[1] + d[2] + d[3]) * 0.5f;
+            // The junction is loaded with the input here.
+            v += in[i];
+
+            // Calculate the feed values for the delay lines.
+            out[0][i] = v - d[0];
+            out[1][i] = v - d[1];
+            out[2][i] = v - d[2];
+            out[3][i] = v - d[3];
+        }
+
+        // Re-feed the delay lines.
+        for(index = 0;index < 4;index++)
+            DelayLineInBlock(&State->Early.Delay[index], offset,
+                             &out[index][base], count);
+
+        // Output the results of the junction for all four channels.
+        for(index = 0;index < 4;index++)
+        {
+            for(i = base;i < base+count;i++)
+                out[index][i] *= State->Early.Gain;
+        }
+    }
 }
 
 // Low-pass filter input/output routine for late reverb.
@@ -367,181 +440,310 @@ static __inline ALfloat LateLowPassInOut(ALverbState *State, ALuint index, ALflo
     return in;
 }
 
-// Given four decorrelated input samples, this function produces four-channel
-// output for the late reverb.
-static __inline ALvoid LateReverb(ALverbState *State, ALfloat *in, ALfloat *out)
+// Given four blocks of decorrelated input samples, this function produces
+// four-channel output for the late reverb.
+static ALvoid LateReverb(ALverbState *State, ALuint todo, ALfloat (*RESTRICT in)[MAX_UPDATE_SAMPLES], ALfloat (*RESTRICT out)[MAX_UPDATE_SAMPLES])
 {
-    ALfloat d[4], f[4];
-
-    // Obtain the decayed results of the cyclical delay lines, and add the
-    // corresponding input channels.  Then pass the results through the
-    // low-pass filters.
-
     // This is where the feed-back cycles from line 0 to 1 to 3 to 2 and back
     // to 0.
-    d[0] = LateLowPassInOut(State, 2, in[2] + LateDelayLineOut(State, 2));
-    d[1] = LateLowPassInOut(State, 0, in[0] + LateDelayLineOut(State, 0));
-    d[2] = LateLowPassInOut(State, 3, in[3] + LateDelayLineOut(State, 3));
-    d[3] = LateLowPassInOut(State, 1, in[1] + LateDelayLineOut(State, 1));
-
-    // To help increase diffusion, run each line through an all-pass filter.
-    // When there is no diffusion, the shortest all-pass filter will feed the
-    // shortest delay line.
-    d[0] = LateAllPassInOut(State, 0, d[0]);
-    d[1] = LateAllPassInOut(State, 1, d[1]);
-    d[2] = LateAllPassInOut(State, 2, d[2]);
-    d[3] = LateAllPassInOut(State, 3, d[3]);
-
-    /* Late reverb is done with a modified feed-back delay network (FDN)
-     * topology.  Four input lines are each fed through their own all-pass
-     * filter and then into the mixing matrix.  The four outputs of the
-     * mixing matrix are then cycled back to the inputs.  Each output feeds
-     * a different input to form a circlular feed cycle.
-     *
-     * The mixing matrix used is a 4D skew-symmetric rotation matrix derived
-     * using a single unitary rotational parameter:
-     *
-     *  [  d,  a,  b,  c ]          1 = a^2 + b^2 + c^2 + d^2
-     *  [ -a,  d,  c, -b ]
-     *  [ -b, -c,  d,  a ]
-     *  [ -c,  b, -a,  d ]
-     *
-     * The rotation is constructed from the effect's diffusion parameter,
-     * yielding:  1 = x^2 + 3 y^2; where a, b, and c are the coefficient y
-     * with differing signs, and d is the coefficient x.  The matrix is thus:
-     *
-     *  [  x,  y, -y,  y ]          n = sqrt(matrix_order - 1)
-     *  [ -y,  x,  y,  y ]          t = diffusion_parameter * atan(n)
-     *  [  y, -y,  x,  y ]          x = cos(t)
-     *  [ -y, -y, -y,  x ]          y = sin(t) / n
-     *
-     * To reduce the number of multiplies, the x coefficient is applied with
-     * the cyclical delay line coefficients.  Thus only the y coefficient is
-     * applied when mixing, and is modified to be:  y / x.
-     */
-    f[0] = d[0] + (State->Late.MixCoeff * (         d[1] + -d[2] + d[3]));
-    f[1] = d[1] + (State->Late.MixCoeff * (-d[0]         +  d[2] + d[3]));
-    f[2] = d[2] + (State->Late.MixCoeff * ( d[0] + -d[1]         + d[3]));
-    f[3] = d[3] + (State->Late.MixCoeff * (-d[0] + -d[1] + -d[2]       ));
-
-    // Output the results of the matrix for all four channels, attenuated by
-    // the late reverb gain (which is attenuated by the 'x' mix coefficient).
-    out[0] = State->Late.Gain * f[0];
-    out[1] = State->Late.Gain * f[1];
-    out[2] = State->Late.Gain * f[2];
-    out[3] = State->Late.Gain * f[3];
-
-    // Re-feed the cyclical delay lines.
-    DelayLineIn(&State->Late.Delay[0], State->Offset, f[0]);
-    DelayLineIn(&State->Late.Delay[1], State->Offset, f[1]);
-    DelayLineIn(&State->Late.Delay[2], State->Offset, f[2]);
-    DelayLineIn(&State->Late.Delay[3], State->Offset, f[3]);
+    static const ALuint LateCycle[4] = { 2, 0, 3, 1 };
+    ALfloat f[4][MAX_UPDATE_SAMPLES];
+    ALfloat d[4];
+    ALuint base, count, offset;
+    ALuint index, line, i;
+
+    for(base = 0;base < todo;base += count)
+    {
+        // The shortest cyclical and all-pass lines bound how many samples can
+        // be read before the feed-back written in this pass would be needed.
+        count = minu(State->Late.Offset[0], State->Late.ApOffset[0]);
+        count = minu(todo-base, maxu(count, 1));
+        offset = State->Offset + base;
+
+        // Obtain the decayed results of the cyclical delay lines, and add the
+        // corresponding input channels.  Then pass the results through the
+        // low-pass filters.
+        for(index = 0;index < 4;index++)
+        {
+            line = LateCycle[index];
+            DelayLineOutBlock(&State->Late.Delay[line],
+                              offset - State->Late.Offset[line],
+                              &out[index][base], count);
+            for(i = base;i < base+count;i++)
+                out[index][i] = LateLowPassInOut(State, line, in[line][i] +
+                                    (State->Late.Coeff[line] * out[index][i]));
+        }
+
+        // To help increase diffusion, run each line through an all-pass
+        // filter.  When there is no diffusion, the shortest all-pass filter
+        // will feed the shortest delay line.
+        for(index = 0;index < 4;index++)
+            AllpassInOutBlock(&State->Late.ApDelay[index], offset,
+                              State->Late.ApOffset[index], &out[index][base],
+                              count, State->Late.ApFeedCoeff,
+                              State->Late.ApCoeff[index]);
+
+        /* Late reverb is done with a modified feed-back delay network (FDN)
+         * topology.  Four input lines are each fed through their own all-pass
+         * filter and then into the mixing matrix.  The four outputs of the
+         * mixing matrix are then cycled back to the inputs.  Each output feeds
+         * a different input to form a circlular feed cycle.
+         *
+         * The mixing matrix used is a 4D skew-symmetric rotation matrix
+         * derived using a single unitary rotational parameter:
+         *
+         *  [  d,  a,  b,  c ]          1 = a^2 + b^2 + c^2 + d^2
+         *  [ -a,  d,  c, -b ]
+         *  [ -b, -c,  d,  a ]
+         *  [ -c,  b, -a,  d ]
+         *
+         * The rotation is constructed from the effect's diffusion parameter,
+         * yielding:  1 = x^2 + 3 y^2; where a, b, and c are the coefficient y
+         * with differing signs, and d is the coefficient x.  The matrix is
+         * thus:
+         *
+         *  [  x,  y, -y,  y ]          n = sqrt(matrix_order - 1)
+         *  [ -y,  x,  y,  y ]          t = diffusion_parameter * atan(n)
+         *  [  y, -y,  x,  y ]          x = cos(t)
+         *  [ -y, -y, -y,  x ]          y = sin(t) / n
+         *
+         * To reduce the number of multiplies, the x coefficient is applied
+         * with the cyclical delay line coefficients.  Thus only the y
+         * coefficient is applied when mixing, and is modified to be:  y / x.
+         */
+        for(i = base;i < base+count;i++)
+        {
+            d[0] = out[0][i];
+            d[1] = out[1][i];
+            d[2] = out[2][i];
+            d[3] = out[3][i];
+
+            f[0][i] = d[0] + (State->Late.MixCoeff * (         d[1] + -d[2] + d[3]));
+            f[1][i] = d[1] + (State->Late.MixCoeff * (-d[0]         +  d[2] + d[3]));
+            f[2][i] = d[2] + (State->Late.MixCoeff * ( d[0] + -d[1]         + d[3]));
+            f[3][i] = d[3] + (State->Late.MixCoeff * (-d[0] + -d[1] + -d[2]       ));
+        }
+
+        // Output the results of the matrix for all four channels, attenuated
+        // by the late reverb gain (which is attenuated by the 'x' mix
+        // coefficient).  Then re-feed the cyclical delay lines.
+        for(index = 0;index < 4;index++)
+        {
+            for(i = base;i < base+count;i++)
+                out[index][i] = State->Late.Gain * f[index][i];
+            DelayLineInBlock(&State->Late.Delay[index], offset,
+                             &f[index][base], count);
+        }
+    }
 }
 
-// Given an input sample, this function mixes echo into the four-channel late
-// reverb.
-static __inline ALvoid EAXEcho(ALverbState *State, ALfloat in, ALfloat *late)
+// Given a block of input samples, this function mixes echo into the four-
+// channel late reverb.
+static ALvoid EAXEcho(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT late)[MAX_UPDATE_SAMPLES])
 {
-    ALfloat out, feed;
+    ALfloat feed[MAX_UPDATE_SAMPLES];
+    ALfloat out, smp;
+    ALuint base, count, offset;
+    ALuint i;
+
+    for(base = 0;base < todo;base += count)
+    {
+        // The echo and all-pass lines bound how many samples can be read
+        // before the feed-back written in this pass would be needed.
+        count = minu(State->Echo.Offset, State->Echo.ApOffset);
+        count = minu(todo-base, maxu(count, 1));
+        offset = State->Offset + base;
+
+        DelayLineOutBlock(&State->Echo.Delay, offset - State->Echo.Offset,
+                          feed, count);
+        for(i = 0;i < count;i++)
+        {
+            // Get the latest attenuated echo sample for output.
+            smp = State->Echo.Coeff * feed[i];
+
+            // Mix the output into the late reverb channels.
+            out = State->Echo.MixCoeff[0] * smp;
+            late[0][base+i] = (State->Echo.MixCoeff[1] * late[0][base+i]) + out;
+            late[1][base+i] = (State->Echo.MixCoeff[1] * late[1][base+i]) + out;
+            late[2][base+i] = (State->Echo.MixCoeff[1] * late[2][base+i]) + out;
+            late[3][base+i] = (State->Echo.MixCoeff[1] * late[3][base+i]) + out;
+
+            // Mix the energy-attenuated input with the output and pass it
+            // through the echo low-pass filter.
+            smp += State->Echo.DensityGain * in[base+i];
+            smp = lerp(smp, State->Echo.LpSample, State->Echo.LpCoeff);
+            State->Echo.LpSample = smp;
+            feed[i] = smp;
+        }
 
-    // Get the latest attenuated echo sample for output.
-    feed = AttenuatedDelayLineOut(&State->Echo.Delay,
-                                  State->Offset - State->Echo.Offset,
-                                  State->Echo.Coeff);
-
-    // Mix the output into the late reverb channels.
-    out = State->Echo.MixCoeff[0] * feed;
-    late[0] = (State->Echo.MixCoeff[1] * late[0]) + out;
-    late[1] = (State->Echo.MixCoeff[1] * late[1]) + out;
-    late[2] = (State->Echo.MixCoeff[1] * late[2]) + out;
-    late[3] = (State->Echo.MixCoeff[1] * late[3]) + out;
-
-    // Mix the energy-attenuated input with the output and pass it through
-    // the echo low-pass filter.
-    feed += State->Echo.DensityGain * in;
-    feed = lerp(feed, State->Echo.LpSample, State->Echo.LpCoeff);
-    State->Echo.LpSample = feed;
-
-    // Then the echo all-pass filter.
-    feed = AllpassInOut(&State->Echo.ApDelay,
-                        State->Offset - State->Echo.ApOffset,
-                        State->Offset, feed, State->Echo.ApFeedCoeff,
-                        State->Echo.ApCoeff);
-
-    // Feed the delay with the mixed and filtered sample.
-    DelayLineIn(&State->Echo.Delay, State->Offset, feed);
+        // Then the echo all-pass filter.
+        AllpassInOutBlock(&State->Echo.ApDelay, offset, State->Echo.ApOffset,
+                          feed, count, State->Echo.ApFeedCoeff,
+                          State->Echo.ApCoeff);
+
+        // Feed the delay with the mixed and filtered samples.
+        DelayLineInBlock(&State->Echo.Delay, offset, feed, count);
+    }
 }
 
-// Perform the non-EAX reverb pass on a given input sample, resulting in
+// Feed the decorrelator from a block of samples, producing the four late
+// reverb input channels from its taps.
+static ALvoid Decorrelate(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT taps)[MAX_UPDATE_SAMPLES])
+{
+    ALuint index, i;
+
+    // The energy-attenuated input is also the first tap.
+    for(i = 0;i < todo;i++)
+        taps[0][i] = in[i] * State->Late.DensityGain;
+    DelayLineInBlock(&State->Decorrelator, State->Offset, taps[0], todo);
+
+    for(index = 0;index < 3;index++)
+        DelayLineOutBlock(&State->Decorrelator,
+                          State->Offset - State->DecoTap[index],
+                          taps[index+1], todo);
+}
+
+// Perform the non-EAX reverb pass on a block of input samples, resulting in
 // four-channel output.
-static __inline ALvoid VerbPass(ALverbState *State, ALfloat in, ALfloat *early, ALfloat *late)
+static ALvoid VerbPass(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT early)[MAX_UPDATE_SAMPLES], ALfloat (*RESTRICT late)[MAX_UPDATE_SAMPLES])
 {
-    ALfloat feed, taps[4];
+    ALfloat feed[MAX_UPDATE_SAMPLES];
+    ALfloat taps[4][MAX_UPDATE_SAMPLES];
+    ALuint i;
 
-    // Low-pass filter the incoming sample.
-    in = lpFilter2P(&State->LpFilter, 0, in);
+    // Low-pass filter the incoming samples.  Callers never pass an empty
+    // block, and stating that here lets the compiler see feed is written.
+    i = 0;
+    do {
+        feed[i] = lpFilter2P(&State->LpFilter, 0, in[i]);
+    } while(++i < todo);
 
     // Feed the initial delay line.
-    DelayLineIn(&State->Delay, State->Offset, in);
+    DelayLineInBlock(&State->Delay, State->Offset, feed, todo);
 
-    // Calculate the early reflection from the first delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[0]);
-    EarlyReflection(State, in, early);
+    // Calculate the early reflections from the first delay tap.
+    DelayLineOutBlock(&State->Delay, State->Offset - State->DelayTap[0],
+                      feed, todo);
+    EarlyReflection(State, todo, feed, early);
 
     // Feed the decorrelator from the energy-attenuated output of the second
     // delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[1]);
-    feed = in * State->Late.DensityGain;
-    DelayLineIn(&State->Decorrelator, State->Offset, feed);
+    DelayLineOutBlock(&State->Delay, State->Offset - State->DelayTap[1],
+                      feed, todo);
+    Decorrelate(State, todo, feed, taps);
 
     // Calculate the late reverb from the decorrelator taps.
-    taps[0] = feed;
-    taps[1] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[0]);
-    taps[2] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[1]);
-    taps[3] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[2]);
-    LateReverb(State, taps, late);
-
-    // Step all delays forward one sample.
-    State->Offset++;
+    LateReverb(State, todo, taps, late);
+
+    // Step all delays forward.
+    State->Offset += todo;
 }
 
-// Perform the EAX reverb pass on a given input sample, resulting in four-
+// Perform the EAX reverb pass on a block of input samples, resulting in four-
 // channel output.
-static __inline ALvoid EAXVerbPass(ALverbState *State, ALfloat in, ALfloat *early, ALfloat *late)
+static ALvoid EAXVerbPass(ALverbState *State, ALuint todo, const ALfloat *RESTRICT in, ALfloat (*RESTRICT early)[MAX_UPDATE_SAMPLES], ALfloat (*RESTRICT late)[MAX_UPDATE_SAMPLES])
 {
-    ALfloat feed, taps[4];
+    ALfloat feed[MAX_UPDATE_SAMPLES];
+    ALfloat taps[4][MAX_UPDATE_SAMPLES];
+    ALuint i;
 
-    // Low-pass filter the incoming sample.
-    in = lpFilter2P(&State->LpFilter, 0, in);
+    // Low-pass filter the incoming samples.  Callers never pass an empty
+    // block, and stating that here lets the compiler see feed is written.
+    i = 0;
+    do {
+        feed[i] = lpFilter2P(&State->LpFilter, 0, in[i]);
+    } while(++i < todo);
 
     // Perform any modulation on the input.
-    in = EAXModulation(State, in);
+    EAXModulation(State, todo, feed);
 
     // Feed the initial delay line.
-    DelayLineIn(&State->Delay, State->Offset, in);
+    DelayLineInBlock(&State->Delay, State->Offset, feed, todo);
 
-    // Calculate the early reflection from the first delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[0]);
-    EarlyReflection(State, in, early);
+    // Calculate the early reflections from the first delay tap.
+    DelayLineOutBlock(&State->Delay, State->Offset - State->DelayTap[0],
+                      feed, todo);
+    EarlyReflection(State, todo, feed, early);
 
     // Feed the decorrelator from the energy-attenuated output of the second
     // delay tap.
-    in = DelayLineOut(&State->Delay, State->Offset - State->DelayTap[1]);
-    feed = in * State->Late.DensityGain;
-    DelayLineIn(&State->Decorrelator, State->Offset, feed);
+    DelayLineOutBlock(&State->Delay, State->Offset - State->DelayTap[1],
+                      feed, todo);
+    Decorrelate(State, todo, feed, taps);
 
     // Calculate the late reverb from the decorrelator taps.
-    taps[0] = feed;
-    taps[1] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[0]);
-    taps[2] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[1]);
-    taps[3] = DelayLineOut(&State->Decorrelator, State->Offset - State->DecoTap[2]);
-    LateReverb(State, taps, late);
+    LateReverb(State, todo, taps, late);
 
     // Calculate and mix in any echo.
-    EAXEcho(State, in, late);
+    EAXEcho(State, todo, feed, late);
+
+    // Step all delays forward.
+    State->Offset += todo;
+}
+
+// Runs a reverb pass at the reduced rate. The input is decimated by averaging
+// each group of 1<<Shift samples (a box filter, the cheapest polyphase
+// decimator), and the early and late outputs are linearly interpolated back up
+// to the device rate.  This adds up to two reduced-rate samples of latency.
+static ALvoid ReducedRatePass(ALverbState *State, ALboolean isEAX, ALuint todo, const ALfloat *in, ALfloat (*early)[MAX_UPDATE_SAMPLES], ALfloat (*late)[MAX_UPDATE_SAMPLES])
+{
+    const ALuint step = 1<<State->Rate.Shift;
+    const ALfloat scale = 1.0f / step;
+    ALfloat reduced[MAX_UPDATE_SAMPLES];
+    ALfloat lowEarly[4][MAX_UPDATE_SAMPLES];
+    ALfloat lowLate[4][MAX_UPDATE_SAMPLES];
+    ALuint count, total, index, i, c;
+    ALfloat mu;
+
+    // Decimate the input.
+    count = State->Rate.Count;
+    total = 0;
+    for(i = 0;i < todo;i++)
+    {
+        State->Rate.Sum += in[i];
+        if(++count == step)
+        {
+            reduced[total++] = State->Rate.Sum * scale;
+            State->Rate.Sum = 0.0f;
+            count = 0;
+        }
+    }
+
+    if(total > 0)
+    {
+        if(isEAX)
+            EAXVerbPass(State, total, reduced, lowEarly, lowLate);
+        else
+            VerbPass(State, total, reduced, lowEarly, lowLate);
+    }
 
-    // Step all delays forward one sample.
-    State->Offset++;
+    // Interpolate the output, stepping to the next reduced-rate sample at the
+    // end of each group.
+    count = State->Rate.Count;
+    index = 0;
+    for(i = 0;i < todo;i++)
+    {
+        mu = (count+1) * scale;
+        for(c = 0;c < 4;c++)
+        {
+            early[c][i] = lerp(State->Rate.Early[0][c], State->Rate.Early[1][c], mu);
+            late[c][i] = lerp(State->Rate.Late[0][c], State->Rate.Late[1][c], mu);
+        }
+
+        if(++count == step)
+        {
+            for(c = 0;c < 4;c++)
+            {
+                State->Rate.Early[0][c] = State->Rate.Early[1][c];
+                State->Rate.Early[1][c] = lowEarly[c][index];
+                State->Rate.Late[0][c] = State->Rate.Late[1][c];
+                State->Rate.Late[1][c] = lowLate[c][index];
+            }
+            index++;
+            count = 0;
+        }
+    }
+    State->Rate.Count = count;
 }
 
 // This processes the reverb state, given the input samples and an output
@@ -549,24 +751,34 @@ static __inline ALvoid EAXVerbPass(ALverbState *State, ALfloat in, ALfloat *earl
 static ALvoid VerbProcess(ALeffectState *effect, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint index, c;
-    ALfloat early[4], late[4], out[4];
+    ALfloat early[4][MAX_UPDATE_SAMPLES];
+    ALfloat late[4][MAX_UPDATE_SAMPLES];
     const ALfloat *panGain = State->Gain;
+    ALuint base, todo, index, c;
+    ALfloat out[4];
 
-    for(index = 0;index < SamplesToDo;index++)
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        // Process reverb for this sample.
-        VerbPass(State, SamplesIn[index], early, late);
-
-        // Mix early reflections and late reverb.
-        out[0] = (early[0] + late[0]);
-        out[1] = (early[1] + late[1]);
-        out[2] = (early[2] + late[2]);
-        out[3] = (early[3] + late[3]);
-
-        // Output the results.
-        for(c = 0;c < MAXCHANNELS;c++)
-            SamplesOut[index][c] += panGain[c] * out[c&3];
+        todo = minu(SamplesToDo-base, MAX_UPDATE_SAMPLES);
+
+        // Process reverb for this block.
+        if(State->Rate.Shift)
+            ReducedRatePass(State, AL_FALSE, todo, &SamplesIn[base], early, late);
+        else
+            VerbPass(State, todo, &SamplesIn[base], early, late);
+
+        for(index = 0;index < todo;index++)
+        {
+            // Mix early reflections and late reverb.
+            out[0] = (early[0][index] + late[0][index]);
+            out[1] = (early[1][index] + late[1][index]);
+            out[2] = (early[2][index] + late[2][index]);
+            out[3] = (early[3][index] + late[3][index]);
+
+            // Output the results.
+            for(c = 0;c < MAXCHANNELS;c++)
+                SamplesOut[base+index][c] += panGain[c] * out[c&3];
+        }
     }
 }
 
@@ -575,17 +787,27 @@ static ALvoid VerbProcess(ALeffectState *effect, ALuint SamplesToDo, const ALflo
 static ALvoid EAXVerbProcess(ALeffectState *effect, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS])
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint index, c;
-    ALfloat early[4], late[4];
+    ALfloat early[4][MAX_UPDATE_SAMPLES];
+    ALfloat late[4][MAX_UPDATE_SAMPLES];
+    ALuint base, todo, index, c;
 
-    for(index = 0;index < SamplesToDo;index++)
+    for(base = 0;base < SamplesToDo;base += todo)
     {
-        // Process reverb for this sample.
-        EAXVerbPass(State, SamplesIn[index], early, late);
+        todo = minu(SamplesToDo-base, MAX_UPDATE_SAMPLES);
 
-        for(c = 0;c < MAXCHANNELS;c++)
-            SamplesOut[index][c] += State->Early.PanGain[c]*early[c&3] +
-                                    State->Late.PanGain[c]*late[c&3];
+        // Process reverb for this block.
+        if(State->Rate.Shift)
+            ReducedRatePass(State, AL_TRUE, todo, &SamplesIn[base], early, late);
+        else
+            EAXVerbPass(State, todo, &SamplesIn[base], early, late);
+
+        for(index = 0;index < todo;index++)
+        {
+            for(c = 0;c < MAXCHANNELS;c++)
+                SamplesOut[base+index][c] +=
+                    State->Early.PanGain[c]*early[c&3][index] +
+                    State->Late.PanGain[c]*late[c&3][index];
+        }
     }
 }
 
@@ -598,13 +820,14 @@ static __inline ALvoid RealizeLineOffset(ALfloat * sampleBuffer, DelayLine *Dela
 }
 
 // Calculate the length of a delay line and store its mask and offset.
-static ALuint CalcLineLength(ALfloat length, ALintptrEXT offset, ALuint frequency, DelayLine *Delay)
+static ALuint CalcLineLength(ALfloat length, ALintptrEXT offset, ALuint frequency, ALuint extra, DelayLine *Delay)
 {
     ALuint samples;
 
-    // All line lengths are powers of 2, calculated from their lengths, with
-    // an additional sample in case of rounding errors.
-    samples = NextPowerOf2(fastf2u(length * frequency) + 1);
+    // All line lengths are powers of 2, calculated from their lengths and
+    // any extra room needed for block updates, with an additional sample in
+    // case of rounding errors.
+    samples = NextPowerOf2(fastf2u(length * frequency) + extra + 1);
     // All lines share a single sample buffer.
     Delay->Mask = samples - 1;
     Delay->Line = (ALfloat*)offset;
@@ -634,45 +857,47 @@ static ALboolean AllocLines(ALuint frequency, ALverbState *State)
     length = (AL_EAXREVERB_MAX_MODULATION_TIME*MODULATION_DEPTH_COEFF/2.0f) +
              (1.0f / frequency);
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Mod.Delay);
+                                   MAX_UPDATE_SAMPLES, &State->Mod.Delay);
 
     // The initial delay is the sum of the reflections and late reverb
-    // delays.
+    // delays.  It is fed a whole block before the early and late taps are
+    // read.
     length = AL_EAXREVERB_MAX_REFLECTIONS_DELAY +
              AL_EAXREVERB_MAX_LATE_REVERB_DELAY;
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Delay);
+                                   MAX_UPDATE_SAMPLES, &State->Delay);
 
     // The early reflection lines.
     for(index = 0;index < 4;index++)
         totalSamples += CalcLineLength(EARLY_LINE_LENGTH[index], totalSamples,
-                                       frequency, &State->Early.Delay[index]);
+                                       frequency, 0, &State->Early.Delay[index]);
 
     // The decorrelator line is calculated from the lowest reverb density (a
-    // parameter value of 1).
+    // parameter value of 1).  Like the initial delay, it is fed a whole block
+    // before its taps are read.
     length = (DECO_FRACTION * DECO_MULTIPLIER * DECO_MULTIPLIER) *
              LATE_LINE_LENGTH[0] * (1.0f + LATE_LINE_MULTIPLIER);
     totalSamples += CalcLineLength(length, totalSamples, frequency,
-                                   &State->Decorrelator);
+                                   MAX_UPDATE_SAMPLES, &State->Decorrelator);
 
     // The late all-pass lines.
     for(index = 0;index < 4;index++)
         totalSamples += CalcLineLength(ALLPASS_LINE_LENGTH[index], totalSamples,
-                                       frequency, &State->Late.ApDelay[index]);
+                                       frequency, 0, &State->Late.ApDelay[index]);
 
     // The late delay lines are calculated from the lowest reverb density.
     for(index = 0;index < 4;index++)
     {
         length = LATE_LINE_LENGTH[index] * (1.0f + LATE_LINE_MULTIPLIER);
-        totalSamples += CalcLineLength(length, totalSamples, frequency,
+        totalSamples += CalcLineLength(length, totalSamples, frequency, 0,
                                        &State->Late.Delay[index]);
     }
 
     // The echo all-pass and delay lines.
     totalSamples += CalcLineLength(ECHO_ALLPASS_LENGTH, totalSamples,
-                                   frequency, &State->Echo.ApDelay);
+                                   frequency, 0, &State->Echo.ApDelay);
     totalSamples += CalcLineLength(AL_EAXREVERB_MAX_ECHO_TIME, totalSamples,
-                                   frequency, &State->Echo.Delay);
+                                   frequency, 0, &State->Echo.Delay);
 
     if(totalSamples != State->TotalSamples)
     {
@@ -710,9 +935,20 @@ static ALboolean AllocLines(ALuint frequency, ALverbState *State)
 static ALboolean ReverbDeviceUpdate(ALeffectState *effect, ALCdevice *Device)
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint frequency = Device->Frequency, index;
+    ALuint frequency, index;
 
-    // Allocate the delay lines.
+    // Pick up the reduced processing rate, and reset the rate conversion.
+    State->Rate.Shift = ReverbRateShift;
+    State->Rate.Count = 0;
+    State->Rate.Sum = 0.0f;
+    for(index = 0;index < 4;index++)
+    {
+        State->Rate.Early[0][index] = State->Rate.Early[1][index] = 0.0f;
+        State->Rate.Late[0][index] = State->Rate.Late[1][index] = 0.0f;
+    }
+    frequency = Device->Frequency >> State->Rate.Shift;
+
+    // Allocate the delay lines (sized for the processing rate).
     if(!AllocLines(frequency, State))
         return AL_FALSE;
 
@@ -1084,9 +1320,9 @@ static ALvoid Update3DPanning(const ALCdevice *Device, const ALfloat *Reflection
 static ALvoid ReverbUpdate(ALeffectState *effect, ALCdevice *Device, const ALeffectslot *Slot)
 {
     ALverbState *State = (ALverbState*)effect;
-    ALuint frequency = Device->Frequency;
+    ALuint frequency = Device->Frequency >> State->Rate.Shift;
     ALboolean isEAX = AL_FALSE;
-    ALfloat cw, x, y, hfRatio;
+    ALfloat hfRef, cw, x, y, hfRatio;
 
     if(Slot->effect.type == AL_EFFECT_EAXREVERB && !EmulateEAXReverb)
     {
@@ -1100,8 +1336,13 @@ static ALvoid ReverbUpdate(ALeffectState *effect, ALCdevice *Device, const ALeff
     }
 
     // Calculate the master low-pass filter (from the master effect HF gain).
-    if(isEAX) cw = CalcI3DL2HFreq(Slot->effect.Reverb.HFReference, frequency);
-    else cw = CalcI3DL2HFreq(LOWPASSFREQREF, frequency);
+    // At a reduced rate the reference can be above the Nyquist frequency,
+    // where its cosine would fold back, so it's kept just below it.
+    if(isEAX) hfRef = Slot->effect.Reverb.HFReference;
+    else hfRef = LOWPASSFREQREF;
+    if(State->Rate.Shift)
+        hfRef = minf(hfRef, frequency*0.45f);
+    cw = CalcI3DL2HFreq(hfRef, frequency);
     // This is done with 2 chained 1-pole filters, so no need to square g.
     State->LpFilter.coeff = lpCoeffCalc(Slot->effect.Reverb.GainHF, cw);
 
@@ -1172,6 +1413,22 @@ static ALvoid ReverbUpdate(ALeffectState *effect, ALCdevice *Device, const ALeff
             State->Gain[chan] = gain;
         }
     }
+
+    // The tail lasts through the initial delays, plus the time for the late
+    // reverb to decay below the silence threshold (using the slower of the
+    // low and high frequency decay times).  It's given in device samples.
+    State->TailLength = State->DelayTap[1] + State->DecoTap[2] +
+                        fastf2u(CalcDecayLength(EFFECT_SILENCE_THRESHOLD,
+                                                Slot->effect.Reverb.DecayTime *
+                                                maxf(hfRatio, 1.0f)) * frequency);
+    State->TailLength <<= State->Rate.Shift;
+}
+
+// This returns the length of the reverb's tail in samples.
+static ALuint ReverbGetTailLength(ALeffectState *effect)
+{
+    ALverbState *State = (ALverbState*)effect;
+    return State->TailLength;
 }
 
 // This destroys the reverb state.  It should be called only when the effect
@@ -1202,6 +1459,7 @@ ALeffectState *ReverbCreate(void)
     State->state.DeviceUpdate = ReverbDeviceUpdate;
     State->state.Update = ReverbUpdate;
     State->state.Process = VerbProcess;
+    State->state.GetTailLength = ReverbGetTailLength;
 
     State->TotalSamples = 0;
     State->SampleBuffer = NULL;
@@ -1280,6 +1538,16 @@ ALeffectState *ReverbCreate(void)
     State->Echo.MixCoeff[1] = 0.0f;
 
     State->Offset = 0;
+    State->TailLength = 0;
+
+    State->Rate.Shift = 0;
+    State->Rate.Count = 0;
+    State->Rate.Sum = 0.0f;
+    for(index = 0;index < 4;index++)
+    {
+        State->Rate.Early[0][index] = State->Rate.Early[1][index] = 0.0f;
+        State->Rate.Late[0][index] = State->Rate.Late[1][index] = 0.0f;
+    }
 
     State->Gain = State->Late.PanGain;
 
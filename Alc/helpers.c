@@ -24,6 +24,12 @@
 #ifdef HAVE_DLFCN_H
 #include <dlfcn.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if defined(HAVE_GUIDDEF_H) || defined(HAVE_INITGUID_H)
 #define INITGUID
@@ -259,6 +265,144 @@ void al_print(const char *func, const char *fmt, ...)
 }
 
 
+/* Allocates memory aligned to the given power of two, which must be freed
+ * with al_free. */
+void *al_malloc(size_t alignment, size_t size)
+{
+#if defined(HAVE_POSIX_MEMALIGN)
+    void *ret;
+    if(posix_memalign(&ret, alignment, size) == 0)
+        return ret;
+    return NULL;
+#else
+    char *ret = malloc(size+alignment);
+    if(ret != NULL)
+    {
+        *(ret++) = 0x00;
+        while(((size_t)ret&(alignment-1)) != 0)
+            *(ret++) = 0x55;
+    }
+    return ret;
+#endif
+}
+
+void *al_calloc(size_t alignment, size_t size)
+{
+    void *ret = al_malloc(alignment, size);
+    if(ret) memset(ret, 0, size);
+    return ret;
+}
+
+void al_free(void *ptr)
+{
+#if defined(HAVE_POSIX_MEMALIGN)
+    free(ptr);
+#else
+    if(ptr != NULL)
+    {
+        char *finder = ptr;
+        do {
+            --finder;
+        } while(*finder == 0x55);
+        free(finder);
+    }
+#endif
+}
+
+
+/* Returns the number of processors online, or 1 if that can't be found. */
+ALuint GetProcessorCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (info.dwNumberOfProcessors > 0) ? info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (ALuint)count : 1;
+#else
+    return 1;
+#endif
+}
+
+
+/* Maps a whole file read-only, so its pages can be shared with other
+ * processes mapping the same file. Where mapping isn't available, the file is
+ * read into an allocated copy instead. */
+void *MapFileToMem(const char *fname, size_t *retlen)
+{
+#ifdef HAVE_SYS_MMAN_H
+    void *ptr;
+    int fd;
+
+    fd = open(fname, O_RDONLY, 0);
+    if(fd == -1)
+        return NULL;
+
+    ptr = MapFdToMem(fd, retlen);
+    close(fd);
+    return ptr;
+#else
+    void *ptr = NULL;
+    long size;
+    FILE *f;
+
+    f = fopen(fname, "rb");
+    if(!f)
+        return NULL;
+
+    if(fseek(f, 0, SEEK_END) == 0 && (size=ftell(f)) > 0 &&
+       fseek(f, 0, SEEK_SET) == 0 && (ptr=malloc(size)) != NULL)
+    {
+        if(fread(ptr, 1, size, f) != (size_t)size)
+        {
+            free(ptr);
+            ptr = NULL;
+        }
+        else
+            *retlen = size;
+    }
+    fclose(f);
+
+    return ptr;
+#endif
+}
+
+/* Maps the whole of an already open file the same way. The descriptor is
+ * left open for the caller. Without mapping support this always fails. */
+void *MapFdToMem(int fd, size_t *retlen)
+{
+#ifdef HAVE_SYS_MMAN_H
+    struct stat st;
+    void *ptr;
+
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+        return NULL;
+
+    ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED)
+        return NULL;
+
+    *retlen = st.st_size;
+    return ptr;
+#else
+    (void)fd;
+    (void)retlen;
+    return NULL;
+#endif
+}
+
+void UnmapFileMem(void *ptr, size_t len)
+{
+#ifdef HAVE_SYS_MMAN_H
+    munmap(ptr, len);
+#else
+    free(ptr);
+    (void)len;
+#endif
+}
+
+
 void SetRTPriority(void)
 {
     ALboolean failed = AL_FALSE;
@@ -30,6 +30,7 @@
 
 
 static const ALchar magicMarker[8] = "MinPHR00";
+static const ALchar binaryMarker[8] = "MinPHRF0";
 
 #define HRIR_COUNT 828
 #define ELEV_COUNT 19
@@ -38,17 +39,120 @@ static const ALushort evOffset[ELEV_COUNT] = { 0, 1, 13, 37, 73, 118, 174, 234,
 static const ALubyte azCount[ELEV_COUNT] = { 1, 12, 24, 36, 45, 56, 60, 72, 72, 72, 72, 72, 60, 56, 45, 36, 24, 12, 1 };
 
 
-static const struct Hrtf {
+// The HRIR sets are kept as float, converted once when they're loaded, so
+// coefficient updates don't have to convert from int16 for every tap.  The
+// values keep their int16 scale; normalization is folded into the gain.
+struct Hrtf {
+    ALuint sampleRate;
+    const ALfloat (*coeffs)[HRIR_LENGTH];
+    const ALubyte *delays;
+
+    // A mapped binary table the coefficients and delays point into, or NULL
+    // if they were allocated along with this struct
+    void *mapping;
+    size_t mappingSize;
+
+    struct Hrtf *next;
+};
+
+// Layout of a binary table.  Its values are in the native byte order and
+// float format, so it can be mapped and used in place, with the pages shared
+// between processes.  The header is followed by the float coefficients
+// [HRIR_COUNT][HRIR_LENGTH], then the delays [HRIR_COUNT].
+struct HrtfBinaryHeader {
+    ALchar magic[8];
+    ALuint byteOrder;  // 0x01020304 as written by the machine that uses it
+    ALuint sampleRate;
+    ALushort hrirCount;
+    ALushort hrirSize;
+    ALushort evCount;
+    ALushort evOffset[ELEV_COUNT];
+    ALubyte reserved[4];  // pads the header to 64 bytes
+};
+
+#define HRTF_BINARY_SIZE  (sizeof(struct HrtfBinaryHeader) +                  \
+                           HRIR_COUNT*HRIR_LENGTH*sizeof(ALfloat) +           \
+                           HRIR_COUNT*sizeof(ALubyte))
+
+static const struct {
     ALuint sampleRate;
     ALshort coeffs[HRIR_COUNT][HRIR_LENGTH];
     ALubyte delays[HRIR_COUNT];
-} DefaultHrtf = {
+} DefaultHrtfData = {
     44100,
 #include "hrtf_tables.inc"
 };
 
+// Nothing is loaded until the first device asks for HRTF.  The sets are kept
+// until the library is unloaded.
+static ALboolean HrtfsLoaded = AL_FALSE;
+static struct Hrtf *DefaultHrtf = NULL;
 static struct Hrtf *LoadedHrtfs = NULL;
-static ALuint NumLoadedHrtfs = 0;
+
+// Sets resampled for other device rates, kept until the library is unloaded
+static struct Hrtf *ResampledHrtfs = NULL;
+
+
+// An interpolated HRIR, before gain is applied.
+struct HrirSet {
+    ALfloat coeffs[HRIR_LENGTH][2];
+    ALfloat delays[2];
+};
+
+// Directions are quantized to 512 elevation steps over pi and 1024 azimuth
+// steps over 2pi (about 0.35 degrees each way) to key the cache.
+#define HRTF_CACHE_EV_STEPS  512
+#define HRTF_CACHE_AZ_STEPS  1024
+#define HRTF_CACHE_BITS      6
+#define HRTF_CACHE_SIZE      (1<<HRTF_CACHE_BITS)
+
+// A small direct-mapped cache of interpolated HRIRs, shared by all sources
+// on a device.  Sources often sit at similar directions, and listener
+// rotation would otherwise recompute every one of them at once.  It's only
+// accessed while the device is locked, from source updates.
+struct HrtfCache {
+    const struct Hrtf *Hrtf;
+    struct {
+        ALuint Key;
+        struct HrirSet Hrir;
+    } Entries[HRTF_CACHE_SIZE];
+};
+
+
+// Virtual speakers of the HRTF bus, in ascending angle order for panning.
+#define HRTF_BUS_SPEAKERS  8
+static const struct {
+    enum Channel chan;
+    ALfloat angle;
+} HrtfBusSpeakers[HRTF_BUS_SPEAKERS] = {
+    { BACK_LEFT,   -150.0f * F_PI/180.0f },
+    { SIDE_LEFT,    -90.0f * F_PI/180.0f },
+    { FRONT_LEFT,   -30.0f * F_PI/180.0f },
+    { FRONT_CENTER,   0.0f * F_PI/180.0f },
+    { FRONT_RIGHT,   30.0f * F_PI/180.0f },
+    { SIDE_RIGHT,    90.0f * F_PI/180.0f },
+    { BACK_RIGHT,   150.0f * F_PI/180.0f },
+    { BACK_CENTER,  180.0f * F_PI/180.0f }
+};
+
+// Input samples kept per virtual speaker, enough for the longest delay plus
+// the HRIR length.
+#define HRTF_BUS_HISTORY  (SRC_HISTORY_LENGTH+HRIR_LENGTH)
+
+// With the HRTF bus, sources and effects are panned into the virtual
+// speakers like on a surround device, and each speaker is convolved with
+// its static HRIR once for the whole device.
+struct HrtfBus {
+    ALfloat Coeffs[HRTF_BUS_SPEAKERS][HRIR_LENGTH][2];
+    ALuint Delays[HRTF_BUS_SPEAKERS][2];
+
+    ALfloat History[HRTF_BUS_SPEAKERS][HRTF_BUS_HISTORY];
+    // Trailing silent input samples per speaker, to skip idle ones
+    ALuint Silent[HRTF_BUS_SPEAKERS];
+
+    ALfloat Input[HRTF_BUS_HISTORY+BUFFERSIZE];
+    ALfloat Output[BUFFERSIZE][2];
+};
 
 
 // Calculate the elevation indices given the polar elevation in radians.
@@ -106,11 +210,10 @@ ALfloat CalcHrtfDelta(ALfloat oldGain, ALfloat newGain, const ALfloat olddir[3],
     return minf(change, 1.0f);
 }
 
-// Calculates static HRIR coefficients and delays for the given polar
-// elevation and azimuth in radians.  Linear interpolation is used to
-// increase the apparent resolution of the HRIR dataset.  The coefficients
-// are also normalized and attenuated by the specified gain.
-void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays)
+// Calculates the HRIR coefficients and delays for the given polar elevation
+// and azimuth in radians.  Linear interpolation is used to increase the
+// apparent resolution of the HRIR dataset.
+static void InterpolateHrir(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, struct HrirSet *hrir)
 {
     ALuint evidx[2], azidx[2];
     ALfloat mu[3];
@@ -142,20 +245,91 @@ void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azi
     ridx[2] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[0]) % azCount[evidx[1]]);
     ridx[3] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[1]) % azCount[evidx[1]]);
 
-    // Calculate the normalized and attenuated HRIR coefficients using linear
-    // interpolation when there is enough gain to warrant it.  Zero the
-    // coefficients if gain is too low.
+    for(i = 0;i < HRIR_LENGTH;i++)
+    {
+        hrir->coeffs[i][0] = lerp(lerp(Hrtf->coeffs[lidx[0]][i], Hrtf->coeffs[lidx[1]][i], mu[0]),
+                                  lerp(Hrtf->coeffs[lidx[2]][i], Hrtf->coeffs[lidx[3]][i], mu[1]),
+                                  mu[2]);
+        hrir->coeffs[i][1] = lerp(lerp(Hrtf->coeffs[ridx[0]][i], Hrtf->coeffs[ridx[1]][i], mu[0]),
+                                  lerp(Hrtf->coeffs[ridx[2]][i], Hrtf->coeffs[ridx[3]][i], mu[1]),
+                                  mu[2]);
+    }
+
+    hrir->delays[0] = lerp(lerp(Hrtf->delays[lidx[0]], Hrtf->delays[lidx[1]], mu[0]),
+                           lerp(Hrtf->delays[lidx[2]], Hrtf->delays[lidx[3]], mu[1]),
+                           mu[2]);
+    hrir->delays[1] = lerp(lerp(Hrtf->delays[ridx[0]], Hrtf->delays[ridx[1]], mu[0]),
+                           lerp(Hrtf->delays[ridx[2]], Hrtf->delays[ridx[3]], mu[1]),
+                           mu[2]);
+}
+
+// Returns the interpolated HRIR for the given direction.  With a cache, the
+// direction is quantized and the result looked up (or computed and stored);
+// without one, it's computed exactly into the provided storage.
+static const struct HrirSet *GetHrir(const struct Hrtf *Hrtf, struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, struct HrirSet *temp)
+{
+    ALuint evq, azq, key, idx;
+
+    if(!Cache)
+    {
+        InterpolateHrir(Hrtf, elevation, azimuth, temp);
+        return temp;
+    }
+
+    if(Cache->Hrtf != Hrtf)
+    {
+        for(idx = 0;idx < HRTF_CACHE_SIZE;idx++)
+            Cache->Entries[idx].Key = ~0u;
+        Cache->Hrtf = Hrtf;
+    }
+
+    evq = fastf2u((F_PI_2 + elevation) * (HRTF_CACHE_EV_STEPS/F_PI));
+    evq = minu(evq, HRTF_CACHE_EV_STEPS);
+    azq = fastf2u((F_PI*2.0f + azimuth) * (HRTF_CACHE_AZ_STEPS/(F_PI*2.0f)));
+    azq %= HRTF_CACHE_AZ_STEPS;
+
+    key = evq*HRTF_CACHE_AZ_STEPS + azq;
+    idx = (key*2654435761u) >> (32-HRTF_CACHE_BITS);
+    if(Cache->Entries[idx].Key != key)
+    {
+        elevation = evq*(F_PI/HRTF_CACHE_EV_STEPS) - F_PI_2;
+        elevation = minf(maxf(elevation, -F_PI_2), F_PI_2);
+        azimuth = azq*(F_PI*2.0f/HRTF_CACHE_AZ_STEPS);
+        InterpolateHrir(Hrtf, elevation, azimuth, &Cache->Entries[idx].Hrir);
+        Cache->Entries[idx].Key = key;
+    }
+    return &Cache->Entries[idx].Hrir;
+}
+
+struct HrtfCache *CreateHrtfCache(void)
+{
+    struct HrtfCache *cache = malloc(sizeof(*cache));
+    if(cache)
+        cache->Hrtf = NULL;
+    return cache;
+}
+
+// Calculates static HRIR coefficients and delays for the given polar
+// elevation and azimuth in radians.  The coefficients are also normalized
+// and attenuated by the specified gain.
+void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays)
+{
+    const struct HrirSet *hrir;
+    struct HrirSet temp;
+    ALuint i;
+
+    hrir = GetHrir(Hrtf, Cache, elevation, azimuth, &temp);
+
+    // Calculate the normalized and attenuated HRIR coefficients when there
+    // is enough gain to warrant it.  Zero the coefficients if gain is too
+    // low.
     if(gain > 0.0001f)
     {
         gain *= 1.0f/32767.0f;
         for(i = 0;i < HRIR_LENGTH;i++)
         {
-            coeffs[i][0] = lerp(lerp(Hrtf->coeffs[lidx[0]][i], Hrtf->coeffs[lidx[1]][i], mu[0]),
-                                lerp(Hrtf->coeffs[lidx[2]][i], Hrtf->coeffs[lidx[3]][i], mu[1]),
-                                mu[2]) * gain;
-            coeffs[i][1] = lerp(lerp(Hrtf->coeffs[ridx[0]][i], Hrtf->coeffs[ridx[1]][i], mu[0]),
-                                lerp(Hrtf->coeffs[ridx[2]][i], Hrtf->coeffs[ridx[3]][i], mu[1]),
-                                mu[2]) * gain;
+            coeffs[i][0] = hrir->coeffs[i][0] * gain;
+            coeffs[i][1] = hrir->coeffs[i][1] * gain;
         }
     }
     else
@@ -167,64 +341,33 @@ void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azi
         }
     }
 
-    // Calculate the HRIR delays using linear interpolation.
-    delays[0] = fastf2u(lerp(lerp(Hrtf->delays[lidx[0]], Hrtf->delays[lidx[1]], mu[0]),
-                             lerp(Hrtf->delays[lidx[2]], Hrtf->delays[lidx[3]], mu[1]),
-                             mu[2]) * 65536.0f);
-    delays[1] = fastf2u(lerp(lerp(Hrtf->delays[ridx[0]], Hrtf->delays[ridx[1]], mu[0]),
-                             lerp(Hrtf->delays[ridx[2]], Hrtf->delays[ridx[3]], mu[1]),
-                             mu[2]) * 65536.0f);
+    delays[0] = fastf2u(hrir->delays[0] * 65536.0f);
+    delays[1] = fastf2u(hrir->delays[1] * 65536.0f);
 }
 
 // Calculates the moving HRIR target coefficients, target delays, and
 // stepping values for the given polar elevation and azimuth in radians.
-// Linear interpolation is used to increase the apparent resolution of the
-// HRIR dataset.  The coefficients are also normalized and attenuated by the
-// specified gain.  Stepping resolution and count is determined using the
-// given delta factor between 0.0 and 1.0.
-ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep)
+// The coefficients are also normalized and attenuated by the specified
+// gain.  Stepping resolution and count is determined using the given delta
+// factor between 0.0 and 1.0.
+ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep)
 {
-    ALuint evidx[2], azidx[2];
-    ALuint lidx[4], ridx[4];
+    const struct HrirSet *hrir;
+    struct HrirSet temp;
     ALfloat left, right;
-    ALfloat mu[3];
     ALfloat step;
     ALuint i;
 
-    // Claculate elevation indices and interpolation factor.
-    CalcEvIndices(elevation, evidx, &mu[2]);
-
-    // Calculate azimuth indices and interpolation factor for the first
-    // elevation.
-    CalcAzIndices(evidx[0], azimuth, azidx, &mu[0]);
-
-    // Calculate the first set of linear HRIR indices for left and right
-    // channels.
-    lidx[0] = evOffset[evidx[0]] + azidx[0];
-    lidx[1] = evOffset[evidx[0]] + azidx[1];
-    ridx[0] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[0]) % azCount[evidx[0]]);
-    ridx[1] = evOffset[evidx[0]] + ((azCount[evidx[0]]-azidx[1]) % azCount[evidx[0]]);
-
-    // Calculate azimuth indices and interpolation factor for the second
-    // elevation.
-    CalcAzIndices(evidx[1], azimuth, azidx, &mu[1]);
-
-    // Calculate the second set of linear HRIR indices for left and right
-    // channels.
-    lidx[2] = evOffset[evidx[1]] + azidx[0];
-    lidx[3] = evOffset[evidx[1]] + azidx[1];
-    ridx[2] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[0]) % azCount[evidx[1]]);
-    ridx[3] = evOffset[evidx[1]] + ((azCount[evidx[1]]-azidx[1]) % azCount[evidx[1]]);
+    hrir = GetHrir(Hrtf, Cache, elevation, azimuth, &temp);
 
     // Calculate the stepping parameters.
     delta = maxf(aluFloor(delta*(Hrtf->sampleRate*0.015f) + 0.5f), 1.0f);
     step = 1.0f / delta;
 
-    // Calculate the normalized and attenuated target HRIR coefficients using
-    // linear interpolation when there is enough gain to warrant it.  Zero
-    // the target coefficients if gain is too low.  Then calculate the
-    // coefficient stepping values using the target and previous running
-    // coefficients.
+    // Calculate the normalized and attenuated target HRIR coefficients when
+    // there is enough gain to warrant it.  Zero the target coefficients if
+    // gain is too low.  Then calculate the coefficient stepping values using
+    // the target and previous running coefficients.
     if(gain > 0.0001f)
     {
         gain *= 1.0f/32767.0f;
@@ -233,12 +376,8 @@ ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat a
             left = coeffs[i][0] - (coeffStep[i][0] * counter);
             right = coeffs[i][1] - (coeffStep[i][1] * counter);
 
-            coeffs[i][0] = lerp(lerp(Hrtf->coeffs[lidx[0]][i], Hrtf->coeffs[lidx[1]][i], mu[0]),
-                                lerp(Hrtf->coeffs[lidx[2]][i], Hrtf->coeffs[lidx[3]][i], mu[1]),
-                                mu[2]) * gain;
-            coeffs[i][1] = lerp(lerp(Hrtf->coeffs[ridx[0]][i], Hrtf->coeffs[ridx[1]][i], mu[0]),
-                                lerp(Hrtf->coeffs[ridx[2]][i], Hrtf->coeffs[ridx[3]][i], mu[1]),
-                                mu[2]) * gain;
+            coeffs[i][0] = hrir->coeffs[i][0] * gain;
+            coeffs[i][1] = hrir->coeffs[i][1] * gain;
 
             coeffStep[i][0] = step * (coeffs[i][0] - left);
             coeffStep[i][1] = step * (coeffs[i][1] - right);
@@ -259,18 +398,13 @@ ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat a
         }
     }
 
-    // Calculate the HRIR delays using linear interpolation.  Then calculate
-    // the delay stepping values using the target and previous running
-    // delays.
+    // Calculate the target HRIR delays.  Then calculate the delay stepping
+    // values using the target and previous running delays.
     left = (ALfloat)(delays[0] - (delayStep[0] * counter));
     right = (ALfloat)(delays[1] - (delayStep[1] * counter));
 
-    delays[0] = fastf2u(lerp(lerp(Hrtf->delays[lidx[0]], Hrtf->delays[lidx[1]], mu[0]),
-                             lerp(Hrtf->delays[lidx[2]], Hrtf->delays[lidx[3]], mu[1]),
-                             mu[2]) * 65536.0f);
-    delays[1] = fastf2u(lerp(lerp(Hrtf->delays[ridx[0]], Hrtf->delays[ridx[1]], mu[0]),
-                             lerp(Hrtf->delays[ridx[2]], Hrtf->delays[ridx[3]], mu[1]),
-                             mu[2]) * 65536.0f);
+    delays[0] = fastf2u(hrir->delays[0] * 65536.0f);
+    delays[1] = fastf2u(hrir->delays[1] * 65536.0f);
 
     delayStep[0] = fastf2i(step * (delays[0] - left));
     delayStep[1] = fastf2i(step * (delays[1] - right));
@@ -281,38 +415,334 @@ ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat a
     return fastf2u(delta);
 }
 
-const struct Hrtf *GetHrtf(ALCdevice *device)
+struct HrtfBus *CreateHrtfBus(const struct Hrtf *Hrtf)
+{
+    struct HrtfBus *bus;
+    ALuint delays[2];
+    ALuint s;
+
+    bus = calloc(1, sizeof(*bus));
+    if(!bus)
+        return NULL;
+
+    for(s = 0;s < HRTF_BUS_SPEAKERS;s++)
+    {
+        GetLerpedHrtfCoeffs(Hrtf, NULL, 0.0f, HrtfBusSpeakers[s].angle, 1.0f,
+                            bus->Coeffs[s], delays);
+        bus->Delays[s][0] = minu((delays[0]+32768)>>16, SRC_HISTORY_LENGTH-1);
+        bus->Delays[s][1] = minu((delays[1]+32768)>>16, SRC_HISTORY_LENGTH-1);
+        bus->Silent[s] = HRTF_BUS_HISTORY;
+    }
+    return bus;
+}
+
+ALuint GetHrtfBusSpeakers(enum Channel *Speaker2Chan, ALfloat *SpeakerAngle)
 {
-    if(device->FmtChans == DevFmtStereo)
+    ALuint s;
+    for(s = 0;s < HRTF_BUS_SPEAKERS;s++)
     {
-        ALuint i;
-        for(i = 0;i < NumLoadedHrtfs;i++)
+        Speaker2Chan[s] = HrtfBusSpeakers[s].chan;
+        SpeakerAngle[s] = HrtfBusSpeakers[s].angle;
+    }
+    return HRTF_BUS_SPEAKERS;
+}
+
+// Convolves the virtual speaker channels of the dry buffer, leaving the
+// binaural result in the front left and right channels.
+void ApplyHrtfBus(struct HrtfBus *Bus, ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS], ALuint SamplesToDo)
+{
+    ALfloat *RESTRICT Input = Bus->Input;
+    ALfloat (*RESTRICT Output)[2] = Bus->Output;
+    ALuint s, i, k;
+
+    for(i = 0;i < SamplesToDo;i++)
+    {
+        Output[i][0] = 0.0f;
+        Output[i][1] = 0.0f;
+    }
+
+    for(s = 0;s < HRTF_BUS_SPEAKERS;s++)
+    {
+        const enum Channel chan = HrtfBusSpeakers[s].chan;
+        ALfloat (*RESTRICT Coeffs)[2] = Bus->Coeffs[s];
+        const ALfloat *left, *right;
+        ALfloat outl, outr;
+        ALuint last = 0;
+
+        for(i = 0;i < SamplesToDo;i++)
+        {
+            Input[HRTF_BUS_HISTORY+i] = DryBuffer[i][chan];
+            if(Input[HRTF_BUS_HISTORY+i] != 0.0f)
+                last = i+1;
+        }
+
+        // Once a speaker has been silent for longer than its history, its
+        // output is silent too until new input arrives.
+        if(last == 0)
+        {
+            if(Bus->Silent[s] >= HRTF_BUS_HISTORY)
+                continue;
+            Bus->Silent[s] += SamplesToDo;
+        }
+        else
+            Bus->Silent[s] = SamplesToDo - last;
+
+        memcpy(Input, Bus->History[s], sizeof(Bus->History[s]));
+
+        // Each ear reads the speaker's input at its own delay, with the
+        // HRIR taps running back in time from there.
+        left = &Input[HRTF_BUS_HISTORY - Bus->Delays[s][0]];
+        right = &Input[HRTF_BUS_HISTORY - Bus->Delays[s][1]];
+        for(i = 0;i < SamplesToDo;i++)
         {
-            if(device->Frequency == LoadedHrtfs[i].sampleRate)
-                return &LoadedHrtfs[i];
+            outl = 0.0f;
+            outr = 0.0f;
+            for(k = 0;k < HRIR_LENGTH;k++)
+            {
+                outl += Coeffs[k][0] * *(left-k);
+                outr += Coeffs[k][1] * *(right-k);
+            }
+            Output[i][0] += outl;
+            Output[i][1] += outr;
+            left++;
+            right++;
         }
-        if(device->Frequency == DefaultHrtf.sampleRate)
-            return &DefaultHrtf;
+
+        memcpy(Bus->History[s], &Input[SamplesToDo], sizeof(Bus->History[s]));
     }
-    ERR("Incompatible format: %s %uhz\n",
-        DevFmtChannelsString(device->FmtChans), device->Frequency);
+
+    for(i = 0;i < SamplesToDo;i++)
+    {
+        DryBuffer[i][FRONT_LEFT]  = Output[i][0];
+        DryBuffer[i][FRONT_RIGHT] = Output[i][1];
+    }
+}
+
+// Number of sinc zero crossings on each side of the resampling kernel
+#define HRIR_RESAMPLE_ZEROS  8
+
+// Range of sample rates accepted for loaded HRIR sets
+#define MIN_HRTF_RATE  MIN_OUTPUT_RATE
+#define MAX_HRTF_RATE  192000
+
+// Allocates an HRIR set with room for its coefficients and delays after it,
+// returning writable pointers to them.
+static struct Hrtf *CreateHrtf(ALuint rate, ALfloat (**coeffs)[HRIR_LENGTH], ALubyte **delays)
+{
+    struct Hrtf *hrtf;
+
+    hrtf = malloc(sizeof(*hrtf) + HRIR_COUNT*HRIR_LENGTH*sizeof(ALfloat) +
+                  HRIR_COUNT*sizeof(ALubyte));
+    if(!hrtf)
+        return NULL;
+
+    *coeffs = (ALfloat(*)[HRIR_LENGTH])(hrtf+1);
+    *delays = (ALubyte*)(*coeffs + HRIR_COUNT);
+
+    hrtf->sampleRate = rate;
+    hrtf->coeffs = *coeffs;
+    hrtf->delays = *delays;
+    hrtf->mapping = NULL;
+    hrtf->mappingSize = 0;
+    hrtf->next = NULL;
+
+    return hrtf;
+}
+
+static void DestroyHrtf(struct Hrtf *hrtf)
+{
+    if(hrtf->mapping)
+        UnmapFileMem(hrtf->mapping, hrtf->mappingSize);
+    free(hrtf);
+}
+
+// Resamples an HRIR set to the given rate.  The HRIRs are reconstructed with
+// a Blackman-windowed sinc, low-passed to the lower of the two Nyquist
+// frequencies, and scaled to keep the same frequency response.  Anything
+// past HRIR_LENGTH at the new rate is dropped, so each HRIR is then scaled
+// back up to the energy of its full response.  The delays are rescaled.
+static struct Hrtf *ResampleHrtf(const struct Hrtf *src, ALuint rate)
+{
+    const ALfloat ratio = (ALfloat)src->sampleRate / rate;
+    const ALfloat cutoff = minf(1.0f, 1.0f/ratio);
+    const ALfloat width = HRIR_RESAMPLE_ZEROS / cutoff;
+    // Output taps up to the last one any input tap reaches
+    const ALuint total = maxu(fastf2u((HRIR_LENGTH-1 + width) / ratio) + 1,
+                              HRIR_LENGTH);
+    ALfloat (*kernel)[HRIR_LENGTH];
+    ALfloat (*coeffs)[HRIR_LENGTH];
+    ALubyte *delays;
+    struct Hrtf *hrtf;
+    ALuint i, j, k;
+
+    kernel = malloc(total * sizeof(*kernel));
+    if(!kernel)
+        return NULL;
+    hrtf = CreateHrtf(rate, &coeffs, &delays);
+    if(!hrtf)
+    {
+        free(kernel);
+        return NULL;
+    }
+
+    // The kernel is the same for every HRIR, so calculate it once: the
+    // contribution of input tap k to output tap j.
+    for(j = 0;j < total;j++)
+    {
+        for(k = 0;k < HRIR_LENGTH;k++)
+        {
+            ALfloat x = j*ratio - (ALfloat)k;
+            ALfloat w, y;
+
+            if(aluFabs(x) >= width)
+            {
+                kernel[j][k] = 0.0f;
+                continue;
+            }
+            w = 0.42f + 0.5f*aluCos(F_PI*x/width) + 0.08f*aluCos(2.0f*F_PI*x/width);
+            y = F_PI * cutoff * x;
+            kernel[j][k] = ratio * cutoff * w * ((aluFabs(y) > 1e-6f) ? aluSin(y)/y : 1.0f);
+        }
+    }
+
+    for(i = 0;i < HRIR_COUNT;i++)
+    {
+        ALfloat kept = 0.0f, full = 0.0f;
+
+        for(j = 0;j < total;j++)
+        {
+            ALfloat sum = 0.0f;
+            for(k = 0;k < HRIR_LENGTH;k++)
+                sum += kernel[j][k] * src->coeffs[i][k];
+            if(j < HRIR_LENGTH)
+            {
+                coeffs[i][j] = sum;
+                kept += sum*sum;
+            }
+            full += sum*sum;
+        }
+        if(kept > 0.0f && full > kept)
+        {
+            ALfloat scale = aluSqrt(full / kept);
+            for(j = 0;j < HRIR_LENGTH;j++)
+                coeffs[i][j] *= scale;
+        }
+        delays[i] = minu(fastf2u(src->delays[i] / ratio), SRC_HISTORY_LENGTH-1);
+    }
+    free(kernel);
+
+    return hrtf;
+}
+
+// Maps a binary table, checking that it was written for this machine and
+// matches the layout the mixer expects.
+static struct Hrtf *LoadBinaryHrtf(const char *fname)
+{
+    const ALubyte maxDelay = SRC_HISTORY_LENGTH-1;
+    const struct HrtfBinaryHeader *header;
+    struct Hrtf *hrtf;
+    size_t size;
+    void *ptr;
+    ALuint i;
+
+    ptr = MapFileToMem(fname, &size);
+    if(!ptr)
+    {
+        ERR("Could not map %s\n", fname);
+        return NULL;
+    }
+
+    header = ptr;
+    if(size != HRTF_BINARY_SIZE)
+    {
+        ERR("Unexpected size: %lu (%lu)\n", (unsigned long)size,
+            (unsigned long)HRTF_BINARY_SIZE);
+        goto error;
+    }
+    if(header->byteOrder != 0x01020304)
+    {
+        ERR("Byte order mismatch: 0x%08x\n", header->byteOrder);
+        goto error;
+    }
+    if(header->sampleRate < MIN_HRTF_RATE || header->sampleRate > MAX_HRTF_RATE ||
+       header->hrirCount != HRIR_COUNT || header->hrirSize != HRIR_LENGTH ||
+       header->evCount != ELEV_COUNT)
+    {
+        ERR("Unsupported value: sampleRate=%u (%u-%u), hrirCount=%d (%d), hrirSize=%d (%d), evCount=%d (%d)\n",
+            header->sampleRate, MIN_HRTF_RATE, MAX_HRTF_RATE,
+            header->hrirCount, HRIR_COUNT, header->hrirSize, HRIR_LENGTH,
+            header->evCount, ELEV_COUNT);
+        goto error;
+    }
+    for(i = 0;i < ELEV_COUNT;i++)
+    {
+        if(header->evOffset[i] != evOffset[i])
+        {
+            ERR("Unsupported evOffset[%d] value: %d (%d)\n", i, header->evOffset[i], evOffset[i]);
+            goto error;
+        }
+    }
+
+    hrtf = malloc(sizeof(*hrtf));
+    if(!hrtf)
+    {
+        ERR("Out of memory loading %s\n", fname);
+        goto error;
+    }
+    hrtf->sampleRate = header->sampleRate;
+    hrtf->coeffs = (const ALfloat(*)[HRIR_LENGTH])(header+1);
+    hrtf->delays = (const ALubyte*)(hrtf->coeffs + HRIR_COUNT);
+    hrtf->mapping = ptr;
+    hrtf->mappingSize = size;
+    hrtf->next = NULL;
+
+    for(i = 0;i < HRIR_COUNT;i++)
+    {
+        if(hrtf->delays[i] > maxDelay)
+        {
+            ERR("Invalid delay[%d]: %d (%d)\n", i, hrtf->delays[i], maxDelay);
+            DestroyHrtf(hrtf);
+            return NULL;
+        }
+    }
+
+    return hrtf;
+
+error:
+    UnmapFileMem(ptr, size);
     return NULL;
 }
 
-void InitHrtf(void)
+static void LoadHrtfs(void)
 {
     char *fnamelist=NULL, *next=NULL;
+    struct Hrtf **tail = &LoadedHrtfs;
+    ALfloat (*coeffs)[HRIR_LENGTH];
+    ALubyte *delays;
     const char *val;
+    ALuint i, j;
+
+    HrtfsLoaded = AL_TRUE;
+
+    DefaultHrtf = CreateHrtf(DefaultHrtfData.sampleRate, &coeffs, &delays);
+    if(DefaultHrtf)
+    {
+        for(i = 0;i < HRIR_COUNT;i++)
+        {
+            for(j = 0;j < HRIR_LENGTH;j++)
+                coeffs[i][j] = DefaultHrtfData.coeffs[i][j];
+            delays[i] = DefaultHrtfData.delays[i];
+        }
+    }
 
     if(ConfigValueStr(NULL, "hrtf_tables", &val))
         next = fnamelist = strdup(val);
     while(next && *next)
     {
         const ALubyte maxDelay = SRC_HISTORY_LENGTH-1;
-        struct Hrtf newdata;
+        struct Hrtf *newdata = NULL;
         ALboolean failed;
         ALchar magic[9];
-        ALsizei i, j;
         char *fname;
         FILE *f;
 
@@ -325,6 +755,7 @@ void InitHrtf(void)
                 next--;
                 if(!isspace(*next))
                 {
+                    next++;
                     *(next++) = '\0';
                     break;
                 }
@@ -349,22 +780,40 @@ void InitHrtf(void)
             ERR("Failed to read magic marker\n");
             failed = AL_TRUE;
         }
+        else if(memcmp(magic, binaryMarker, sizeof(binaryMarker)) == 0)
+        {
+            // Binary tables are mapped as-is rather than read
+            fclose(f);
+            f = NULL;
+
+            newdata = LoadBinaryHrtf(fname);
+            failed = !newdata;
+        }
         else if(memcmp(magic, magicMarker, sizeof(magicMarker)) != 0)
         {
             magic[8] = 0;
             ERR("Invalid magic marker: \"%s\"\n", magic);
             failed = AL_TRUE;
         }
+        else
+        {
+            newdata = CreateHrtf(0, &coeffs, &delays);
+            if(!newdata)
+            {
+                ERR("Out of memory loading %s\n", fname);
+                failed = AL_TRUE;
+            }
+        }
 
-        if(!failed)
+        if(!failed && f)
         {
             ALushort hrirCount, hrirSize;
             ALubyte  evCount;
 
-            newdata.sampleRate  = fgetc(f);
-            newdata.sampleRate |= fgetc(f)<<8;
-            newdata.sampleRate |= fgetc(f)<<16;
-            newdata.sampleRate |= fgetc(f)<<24;
+            newdata->sampleRate  = fgetc(f);
+            newdata->sampleRate |= fgetc(f)<<8;
+            newdata->sampleRate |= fgetc(f)<<16;
+            newdata->sampleRate |= fgetc(f)<<24;
 
             hrirCount  = fgetc(f);
             hrirCount |= fgetc(f)<<8;
@@ -374,15 +823,17 @@ void InitHrtf(void)
 
             evCount = fgetc(f);
 
-            if(hrirCount != HRIR_COUNT || hrirSize != HRIR_LENGTH || evCount != ELEV_COUNT)
+            if(newdata->sampleRate < MIN_HRTF_RATE || newdata->sampleRate > MAX_HRTF_RATE ||
+               hrirCount != HRIR_COUNT || hrirSize != HRIR_LENGTH || evCount != ELEV_COUNT)
             {
-                ERR("Unsupported value: hrirCount=%d (%d), hrirSize=%d (%d), evCount=%d (%d)\n",
+                ERR("Unsupported value: sampleRate=%u (%u-%u), hrirCount=%d (%d), hrirSize=%d (%d), evCount=%d (%d)\n",
+                    newdata->sampleRate, MIN_HRTF_RATE, MAX_HRTF_RATE,
                     hrirCount, HRIR_COUNT, hrirSize, HRIR_LENGTH, evCount, ELEV_COUNT);
                 failed = AL_TRUE;
             }
         }
 
-        if(!failed)
+        if(!failed && f)
         {
             for(i = 0;i < ELEV_COUNT;i++)
             {
@@ -397,7 +848,7 @@ void InitHrtf(void)
             }
         }
 
-        if(!failed)
+        if(!failed && f)
         {
             for(i = 0;i < HRIR_COUNT;i++)
             {
@@ -406,14 +857,14 @@ void InitHrtf(void)
                     ALshort coeff;
                     coeff  = fgetc(f);
                     coeff |= fgetc(f)<<8;
-                    newdata.coeffs[i][j] = coeff;
+                    coeffs[i][j] = coeff;
                 }
             }
             for(i = 0;i < HRIR_COUNT;i++)
             {
                 ALubyte delay;
                 delay = fgetc(f);
-                newdata.delays[i] = delay;
+                delays[i] = delay;
                 if(delay > maxDelay)
                 {
                     ERR("Invalid delay[%d]: %d (%d)\n", i, delay, maxDelay);
@@ -428,30 +879,101 @@ void InitHrtf(void)
             }
         }
 
-        fclose(f);
+        if(f)
+            fclose(f);
         f = NULL;
 
         if(!failed)
         {
-            void *temp = realloc(LoadedHrtfs, (NumLoadedHrtfs+1)*sizeof(LoadedHrtfs[0]));
-            if(temp != NULL)
-            {
-                LoadedHrtfs = temp;
-                TRACE("Loaded HRTF support for format: %s %uhz\n",
-                      DevFmtChannelsString(DevFmtStereo), newdata.sampleRate);
-                LoadedHrtfs[NumLoadedHrtfs++] = newdata;
-            }
+            TRACE("Loaded HRTF support for format: %s %uhz\n",
+                  DevFmtChannelsString(DevFmtStereo), newdata->sampleRate);
+            *tail = newdata;
+            tail = &newdata->next;
         }
         else
+        {
             ERR("Failed to load %s\n", fname);
+            if(newdata)
+                DestroyHrtf(newdata);
+        }
     }
     free(fnamelist);
     fnamelist = NULL;
 }
 
+
+// Called with the device list locked, so the set lists can't change under it.
+const struct Hrtf *GetHrtf(ALCdevice *device)
+{
+    if(!HrtfsLoaded)
+        LoadHrtfs();
+
+    if(device->FmtChans == DevFmtStereo && DefaultHrtf)
+    {
+        const struct Hrtf *src;
+        struct Hrtf *hrtf;
+
+        for(hrtf = LoadedHrtfs;hrtf;hrtf = hrtf->next)
+        {
+            if(device->Frequency == hrtf->sampleRate)
+                return hrtf;
+        }
+        if(device->Frequency == DefaultHrtf->sampleRate)
+            return DefaultHrtf;
+
+        for(hrtf = ResampledHrtfs;hrtf;hrtf = hrtf->next)
+        {
+            if(device->Frequency == hrtf->sampleRate)
+                return hrtf;
+        }
+
+        // No set for this rate, so resample the one nearest to it.
+        src = DefaultHrtf;
+        for(hrtf = LoadedHrtfs;hrtf;hrtf = hrtf->next)
+        {
+            if(abs((ALint)(hrtf->sampleRate-device->Frequency)) <
+               abs((ALint)(src->sampleRate-device->Frequency)))
+                src = hrtf;
+        }
+        // At twice the set's rate or more, at least half the output band
+        // has no response to resample, so the device goes without HRTF.
+        if(device->Frequency >= src->sampleRate*2)
+        {
+            TRACE("Not resampling HRTF from %uhz to %uhz\n", src->sampleRate, device->Frequency);
+            hrtf = NULL;
+        }
+        else
+            hrtf = ResampleHrtf(src, device->Frequency);
+        if(hrtf)
+        {
+            TRACE("Resampled HRTF from %uhz to %uhz\n", src->sampleRate, hrtf->sampleRate);
+            hrtf->next = ResampledHrtfs;
+            ResampledHrtfs = hrtf;
+            return hrtf;
+        }
+    }
+    ERR("Incompatible format: %s %uhz\n",
+        DevFmtChannelsString(device->FmtChans), device->Frequency);
+    return NULL;
+}
+
 void FreeHrtf(void)
 {
-    NumLoadedHrtfs = 0;
-    free(LoadedHrtfs);
-    LoadedHrtfs = NULL;
+    while(ResampledHrtfs)
+    {
+        struct Hrtf *next = ResampledHrtfs->next;
+        DestroyHrtf(ResampledHrtfs);
+        ResampledHrtfs = next;
+    }
+    while(LoadedHrtfs)
+    {
+        struct Hrtf *next = LoadedHrtfs->next;
+        DestroyHrtf(LoadedHrtfs);
+        LoadedHrtfs = next;
+    }
+
+    if(DefaultHrtf)
+        DestroyHrtf(DefaultHrtf);
+    DefaultHrtf = NULL;
+    HrtfsLoaded = AL_FALSE;
 }
@@ -83,6 +83,116 @@ static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
     }
 }
 
+static __inline void ApplyCoeffsStep(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                     ALfloat (*RESTRICT Coeffs)[2],
+                                     ALfloat (*RESTRICT CoeffStep)[2],
+                                     ALfloat left, ALfloat right)
+{
+    ALuint c;
+    float32x4_t leftright4;
+    {
+        float32x2_t leftright2 = vdup_n_f32(0.0);
+        leftright2 = vset_lane_f32(left, leftright2, 0);
+        leftright2 = vset_lane_f32(right, leftright2, 1);
+        leftright4 = vcombine_f32(leftright2, leftright2);
+    }
+    for(c = 0;c < HRIR_LENGTH;c += 2)
+    {
+        const ALuint o0 = (Offset+c)&HRIR_MASK;
+        const ALuint o1 = (o0+1)&HRIR_MASK;
+        float32x4_t vals = vcombine_f32(vld1_f32((float32_t*)&Values[o0][0]),
+                                        vld1_f32((float32_t*)&Values[o1][0]));
+        float32x4_t coefs = vld1q_f32((float32_t*)&Coeffs[c][0]);
+        float32x4_t steps = vld1q_f32((float32_t*)&CoeffStep[c][0]);
+
+        vals = vmlaq_f32(vals, coefs, leftright4);
+        coefs = vaddq_f32(coefs, steps);
+
+        vst1_f32((float32_t*)&Values[o0][0], vget_low_f32(vals));
+        vst1_f32((float32_t*)&Values[o1][0], vget_high_f32(vals));
+        vst1q_f32((float32_t*)&Coeffs[c][0], coefs);
+    }
+}
+
+#elif defined(__SSE__) && defined(HAVE_XMMINTRIN_H)
+#include <xmmintrin.h>
+
+/* The Values ring buffer is walked as (at most) two runs that are contiguous
+ * in memory, split where it wraps around, so each pair of taps is a single
+ * unaligned vector load instead of two masked lookups. An odd tap left at the
+ * end of a run is done on its own. */
+static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                 ALfloat (*RESTRICT Coeffs)[2],
+                                 ALfloat left, ALfloat right)
+{
+    const __m128 leftright4 = _mm_setr_ps(left, right, left, right);
+    ALuint off = Offset&HRIR_MASK;
+    ALuint end = HRIR_LENGTH-off;
+    ALuint c = 0;
+
+    for(;;)
+    {
+        for(;c+1 < end;c += 2,off += 2)
+        {
+            __m128 vals = _mm_loadu_ps(&Values[off][0]);
+            __m128 coefs = _mm_loadu_ps(&Coeffs[c][0]);
+
+            vals = _mm_add_ps(vals, _mm_mul_ps(coefs, leftright4));
+
+            _mm_storeu_ps(&Values[off][0], vals);
+        }
+        if(c < end)
+        {
+            Values[off][0] += Coeffs[c][0] * left;
+            Values[off][1] += Coeffs[c][1] * right;
+            c++;
+        }
+        if(end == HRIR_LENGTH)
+            break;
+        off = 0;
+        end = HRIR_LENGTH;
+    }
+}
+
+static __inline void ApplyCoeffsStep(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                     ALfloat (*RESTRICT Coeffs)[2],
+                                     ALfloat (*RESTRICT CoeffStep)[2],
+                                     ALfloat left, ALfloat right)
+{
+    const __m128 leftright4 = _mm_setr_ps(left, right, left, right);
+    ALuint off = Offset&HRIR_MASK;
+    ALuint end = HRIR_LENGTH-off;
+    ALuint c = 0;
+
+    for(;;)
+    {
+        for(;c+1 < end;c += 2,off += 2)
+        {
+            __m128 vals = _mm_loadu_ps(&Values[off][0]);
+            __m128 coefs = _mm_loadu_ps(&Coeffs[c][0]);
+            __m128 steps = _mm_loadu_ps(&CoeffStep[c][0]);
+
+            vals = _mm_add_ps(vals, _mm_mul_ps(coefs, leftright4));
+            coefs = _mm_add_ps(coefs, steps);
+
+            _mm_storeu_ps(&Values[off][0], vals);
+            _mm_storeu_ps(&Coeffs[c][0], coefs);
+        }
+        if(c < end)
+        {
+            Values[off][0] += Coeffs[c][0] * left;
+            Values[off][1] += Coeffs[c][1] * right;
+            Coeffs[c][0] += CoeffStep[c][0];
+            Coeffs[c][1] += CoeffStep[c][1];
+            c++;
+        }
+        if(end == HRIR_LENGTH)
+            break;
+        off = 0;
+        end = HRIR_LENGTH;
+    }
+}
+
 #else
 
 static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
@@ -97,28 +207,42 @@ static __inline void ApplyCoeffs(ALuint Offset, ALfloat (*RESTRICT Values)[2],
         Values[off][1] += Coeffs[c][1] * right;
     }
 }
+
+static __inline void ApplyCoeffsStep(ALuint Offset, ALfloat (*RESTRICT Values)[2],
+                                     ALfloat (*RESTRICT Coeffs)[2],
+                                     ALfloat (*RESTRICT CoeffStep)[2],
+                                     ALfloat left, ALfloat right)
+{
+    ALuint c;
+    for(c = 0;c < HRIR_LENGTH;c++)
+    {
+        const ALuint off = (Offset+c)&HRIR_MASK;
+        Values[off][0] += Coeffs[c][0] * left;
+        Values[off][1] += Coeffs[c][1] * right;
+        Coeffs[c][0] += CoeffStep[c][0];
+        Coeffs[c][1] += CoeffStep[c][1];
+    }
+}
 #endif
 
 #define DECL_TEMPLATE(T, sampler)                                             \
 static void Mix_Hrtf_##T##_##sampler(ALsource *Source, ALCdevice *Device,     \
   const ALvoid *srcdata, ALuint *DataPosInt, ALuint *DataPosFrac,             \
-  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+  ALuint increment, ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)     \
 {                                                                             \
     const ALuint NumChannels = Source->NumChannels;                           \
     const T *RESTRICT data = srcdata;                                         \
-    const ALint *RESTRICT DelayStep = Source->Params.HrtfDelayStep;           \
+    ALhrtfState *RESTRICT HrtfState = Source->HrtfState;                      \
+    const ALint *RESTRICT DelayStep = HrtfState->DelayStep;                   \
     ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS];                               \
     ALfloat *RESTRICT ClickRemoval, *RESTRICT PendingClicks;                  \
-    ALfloat (*RESTRICT CoeffStep)[2] = Source->Params.HrtfCoeffStep;          \
+    ALfloat (*RESTRICT CoeffStep)[2] = HrtfState->CoeffStep;                  \
     ALuint pos, frac;                                                         \
     FILTER *DryFilter;                                                        \
     ALuint BufferIdx;                                                         \
-    ALuint increment;                                                         \
     ALuint i, out, c;                                                         \
     ALfloat value;                                                            \
                                                                               \
-    increment = Source->Params.Step;                                          \
-                                                                              \
     DryBuffer = Device->DryBuffer;                                            \
     ClickRemoval = Device->ClickRemoval;                                      \
     PendingClicks = Device->PendingClicks;                                    \
@@ -129,10 +253,10 @@ static void Mix_Hrtf_##T##_##sampler(ALsource *Source, ALCdevice *Device,     \
                                                                               \
     for(i = 0;i < NumChannels;i++)                                            \
     {                                                                         \
-        ALfloat (*RESTRICT TargetCoeffs)[2] = Source->Params.HrtfCoeffs[i];   \
-        ALuint *RESTRICT TargetDelay = Source->Params.HrtfDelay[i];           \
-        ALfloat *RESTRICT History = Source->HrtfHistory[i];                   \
-        ALfloat (*RESTRICT Values)[2] = Source->HrtfValues[i];                \
+        ALfloat (*RESTRICT TargetCoeffs)[2] = HrtfState->Coeffs[i];           \
+        ALuint *RESTRICT TargetDelay = HrtfState->Delay[i];                   \
+        ALfloat *RESTRICT History = HrtfState->History[i];                    \
+        ALfloat (*RESTRICT Values)[2] = HrtfState->Values[i];                 \
         ALint Counter = maxu(Source->HrtfCounter, OutPos) - OutPos;           \
         ALuint Offset = Source->HrtfOffset + OutPos;                          \
         ALfloat Coeffs[HRIR_LENGTH][2];                                       \
@@ -181,15 +305,7 @@ static void Mix_Hrtf_##T##_##sampler(ALsource *Source, ALCdevice *Device,     \
             Values[Offset&HRIR_MASK][1] = 0.0f;                               \
             Offset++;                                                         \
                                                                               \
-            for(c = 0;c < HRIR_LENGTH;c++)                                    \
-            {                                                                 \
-                const ALuint off = (Offset+c)&HRIR_MASK;                      \
-                Values[off][0] += Coeffs[c][0] * left;                        \
-                Values[off][1] += Coeffs[c][1] * right;                       \
-                Coeffs[c][0] += CoeffStep[c][0];                              \
-                Coeffs[c][1] += CoeffStep[c][1];                              \
-            }                                                                 \
-                                                                              \
+            ApplyCoeffsStep(Offset, Values, Coeffs, CoeffStep, left, right);  \
             DryBuffer[OutPos][FRONT_LEFT]  += Values[Offset&HRIR_MASK][0];    \
             DryBuffer[OutPos][FRONT_RIGHT] += Values[Offset&HRIR_MASK][1];    \
                                                                               \
@@ -307,7 +423,7 @@ DECL_TEMPLATE(ALfloat, cubic32)
 #define DECL_TEMPLATE(T, sampler)                                             \
 static void Mix_##T##_##sampler(ALsource *Source, ALCdevice *Device,          \
   const ALvoid *srcdata, ALuint *DataPosInt, ALuint *DataPosFrac,             \
-  ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)                       \
+  ALuint increment, ALuint OutPos, ALuint SamplesToDo, ALuint BufferSize)     \
 {                                                                             \
     const ALuint NumChannels = Source->NumChannels;                           \
     const T *RESTRICT data = srcdata;                                         \
@@ -317,12 +433,9 @@ static void Mix_##T##_##sampler(ALsource *Source, ALCdevice *Device,          \
     FILTER *DryFilter;                                                        \
     ALuint pos, frac;                                                         \
     ALuint BufferIdx;                                                         \
-    ALuint increment;                                                         \
     ALuint i, out, c;                                                         \
     ALfloat value;                                                            \
                                                                               \
-    increment = Source->Params.Step;                                          \
-                                                                              \
     DryBuffer = Device->DryBuffer;                                            \
     ClickRemoval = Device->ClickRemoval;                                      \
     PendingClicks = Device->PendingClicks;                                    \
@@ -490,18 +603,48 @@ DECL_TEMPLATE(ALfloat)
 
 #undef DECL_TEMPLATE
 
-static void LoadStack(ALfloat *dst, const ALvoid *src, enum FmtType srctype, ALuint samples)
+/* IMA4 blocks each start with their own predictor and step index, so any
+ * frame can be reached by decoding from the start of its block. */
+static void Load_ALima4(ALfloat *dst, const ALubyte *src, ALuint numchans,
+                        ALuint pos, ALuint frames)
 {
-    switch(srctype)
+    ALshort tmp[65*MAXCHANNELS];
+    ALuint skip, todo;
+
+    src += pos/65 * 36*numchans;
+    skip = pos%65;
+    while(frames > 0)
+    {
+        todo = minu(65-skip, frames);
+
+        DecodeIMA4Block(tmp, src, numchans);
+        Load_ALshort(dst, &tmp[skip*numchans], todo*numchans);
+        dst += todo*numchans;
+        frames -= todo;
+
+        src += 36*numchans;
+        skip = 0;
+    }
+}
+
+static void LoadStack(ALfloat *dst, const ALbuffer *buffer, ALuint numchans,
+                      ALuint pos, ALuint frames)
+{
+    const ALubyte *src = buffer->data;
+
+    switch(buffer->FmtType)
     {
         case FmtByte:
-            Load_ALbyte(dst, src, samples);
+            Load_ALbyte(dst, (const ALbyte*)src + pos*numchans, frames*numchans);
             break;
         case FmtShort:
-            Load_ALshort(dst, src, samples);
+            Load_ALshort(dst, (const ALshort*)src + pos*numchans, frames*numchans);
             break;
         case FmtFloat:
-            Load_ALfloat(dst, src, samples);
+            Load_ALfloat(dst, (const ALfloat*)src + pos*numchans, frames*numchans);
+            break;
+        case FmtIMA4:
+            Load_ALima4(dst, src, numchans, pos, frames);
             break;
     }
 }
@@ -513,6 +656,110 @@ static void SilenceStack(ALfloat *dst, ALuint samples)
         dst[i] = 0.0f;
 }
 
+/* Returns how many of the next output samples only read digital silence from
+ * a static, non-looping buffer, according to its envelope. The first sample
+ * past those is silent too, so the click removal at the end of the mix has
+ * nothing to pick up. */
+static ALuint SilentSamples(const ALsource *Source, const ALbuffer *ALBuffer,
+                            ALuint DataPosInt, ALuint DataPosFrac,
+                            ALuint increment, ALuint todo)
+{
+    const ALuint BufferPrePadding = ResamplerPrePadding[Source->Resampler];
+    const ALuint BufferPadding = ResamplerPadding[Source->Resampler];
+    const ALuint NumBlocks = (ALBuffer->SampleLen+ENVELOPE_BLOCK_SIZE-1) /
+                             ENVELOPE_BLOCK_SIZE;
+    ALuint64 end, avail, count;
+    ALuint start, block;
+
+    if(!ALBuffer->Envelope)
+        return 0;
+
+    start = (DataPosInt > BufferPrePadding) ? DataPosInt-BufferPrePadding : 0;
+    block = start / ENVELOPE_BLOCK_SIZE;
+    if(block < NumBlocks && ALBuffer->Envelope[block][0] != 0)
+        return 0;
+
+    /* Find where the silence ends, without looking further than needed */
+    end  = (ALuint64)todo * increment;
+    end += DataPosFrac;
+    end >>= FRACTIONBITS;
+    end += DataPosInt + BufferPadding + 1;
+    while(block < NumBlocks && (ALuint64)block*ENVELOPE_BLOCK_SIZE <= end &&
+          ALBuffer->Envelope[block][0] == 0)
+        block++;
+    if(block >= NumBlocks)
+        return todo;
+    end = (ALuint64)block * ENVELOPE_BLOCK_SIZE;
+
+    if(end <= (ALuint64)DataPosInt+BufferPadding)
+        return 0;
+    avail  = end - DataPosInt - BufferPadding;
+    avail <<= FRACTIONBITS;
+    if(avail <= DataPosFrac)
+        return 0;
+    avail -= DataPosFrac;
+
+    count = (avail-1) / increment;
+    return (count < todo) ? (ALuint)count : todo;
+}
+
+/* Checks if the source's filter and HRTF history has decayed to silence, and
+ * clears it if so. Only then can the source skip mixing without the output
+ * differing from what the filters would have produced. */
+static ALboolean SettleSource(ALsource *Source, const ALCdevice *Device)
+{
+    const ALuint NumChannels = Source->NumChannels;
+    ALhrtfState *HrtfState = Source->HrtfState;
+    ALuint i, j, out;
+
+    for(i = 0;i < NumChannels*2;i++)
+    {
+        if(fabs(Source->Params.iirFilter.history[i]) >= SRC_SILENCE_THRESHOLD)
+            return AL_FALSE;
+    }
+    for(out = 0;out < Device->NumAuxSends;out++)
+    {
+        if(!Source->Params.Send[out].Slot)
+            continue;
+        for(i = 0;i < NumChannels;i++)
+        {
+            if(fabs(Source->Params.Send[out].iirFilter.history[i]) >= SRC_SILENCE_THRESHOLD)
+                return AL_FALSE;
+        }
+    }
+    if(HrtfState)
+    {
+        for(i = 0;i < NumChannels;i++)
+        {
+            for(j = 0;j < SRC_HISTORY_LENGTH;j++)
+            {
+                if(fabs(HrtfState->History[i][j]) >= SRC_SILENCE_THRESHOLD)
+                    return AL_FALSE;
+            }
+            for(j = 0;j < HRIR_LENGTH;j++)
+            {
+                if(fabs(HrtfState->Values[i][j][0]) >= SRC_SILENCE_THRESHOLD ||
+                   fabs(HrtfState->Values[i][j][1]) >= SRC_SILENCE_THRESHOLD)
+                    return AL_FALSE;
+            }
+        }
+    }
+
+    for(i = 0;i < NumChannels*2;i++)
+        Source->Params.iirFilter.history[i] = 0.0f;
+    for(out = 0;out < Device->NumAuxSends;out++)
+    {
+        for(i = 0;i < NumChannels;i++)
+            Source->Params.Send[out].iirFilter.history[i] = 0.0f;
+    }
+    if(HrtfState)
+    {
+        memset(HrtfState->History, 0, sizeof(HrtfState->History));
+        memset(HrtfState->Values, 0, sizeof(HrtfState->Values));
+    }
+    return AL_TRUE;
+}
+
 
 ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
 {
@@ -525,7 +772,6 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     ALenum State;
     ALuint OutPos;
     ALuint NumChannels;
-    ALuint FrameSize;
     ALint64 DataSize64;
     ALuint i;
 
@@ -538,7 +784,6 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
     increment     = Source->Params.Step;
     Resampler     = Source->Resampler;
     NumChannels   = Source->NumChannels;
-    FrameSize     = NumChannels * Source->SampleSize;
 
     /* Get current buffer queue item */
     BufferListItem = Source->queue;
@@ -554,6 +799,84 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
         ALuint SrcDataSize = 0;
         ALuint BufferSize;
 
+        /* Skip over digital silence in a static buffer once the filters have
+         * settled, since mixing it would only add zeros */
+        if(Source->lSourceType == AL_STATIC && Looping == AL_FALSE)
+        {
+            const ALbuffer *ALBuffer = Source->queue->buffer;
+            ALuint64 frac;
+
+            BufferSize = SilentSamples(Source, ALBuffer, DataPosInt, DataPosFrac,
+                                       increment, SamplesToDo-OutPos);
+            if(BufferSize > 0 && SettleSource(Source, Device))
+            {
+                frac  = (ALuint64)BufferSize * increment;
+                frac += DataPosFrac;
+                DataPosInt += (ALuint)(frac>>FRACTIONBITS);
+                DataPosFrac = (ALuint)(frac&FRACTIONMASK);
+                OutPos += BufferSize;
+
+                if(DataPosInt >= (ALuint)ALBuffer->SampleLen)
+                {
+                    State = AL_STOPPED;
+                    BufferListItem = Source->queue;
+                    BuffersPlayed = Source->BuffersInQueue;
+                    DataPosInt = 0;
+                    DataPosFrac = 0;
+                }
+                continue;
+            }
+        }
+
+        /* Mix a static buffer's copy at the device rate, when the source is
+         * on one of its sample positions */
+        if(Source->lSourceType == AL_STATIC && Looping == AL_FALSE)
+        {
+            const ALbuffer *ALBuffer = Source->queue->buffer;
+            const ALbufferCache *Cache = ALBuffer->Resampled;
+            ALuint64 pos;
+
+            pos = ((ALuint64)DataPosInt<<FRACTIONBITS) | DataPosFrac;
+            if(Cache && Cache->Step == increment && (pos%increment) == 0)
+            {
+                ALuint CachePos = 0, CacheFrac = 0;
+                ALuint DataSize = 0;
+
+                pos /= increment;
+
+                /* One more sample than gets mixed, for click removal */
+                BufferSize  = STACK_DATA_SIZE/sizeof(ALfloat) / NumChannels;
+                BufferSize  = minu(BufferSize-1, SamplesToDo-OutPos);
+                if(pos < (ALuint64)Cache->SampleLen)
+                {
+                    DataSize = minu(Cache->SampleLen - (ALuint)pos, BufferSize+1);
+                    memcpy(SrcData, &Cache->data[pos*NumChannels],
+                           DataSize*NumChannels*sizeof(ALfloat));
+                }
+                SilenceStack(&SrcData[DataSize*NumChannels],
+                             (BufferSize+1-DataSize)*NumChannels);
+
+                Source->Params.DoMixPoint(Source, Device, SrcData, &CachePos,
+                                          &CacheFrac, FRACTIONONE, OutPos,
+                                          SamplesToDo, BufferSize);
+                OutPos += BufferSize;
+
+                pos  = (pos+BufferSize) * increment;
+                DataPosInt  = (ALuint)(pos>>FRACTIONBITS);
+                DataPosFrac = (ALuint)(pos&FRACTIONMASK);
+
+                if(DataPosInt >= (ALuint)ALBuffer->SampleLen)
+                {
+                    State = AL_STOPPED;
+                    BufferListItem = Source->queue;
+                    BuffersPlayed = Source->BuffersInQueue;
+                    DataPosInt = 0;
+                    DataPosFrac = 0;
+                }
+                continue;
+            }
+        }
+
         /* Figure out how many buffer bytes will be needed */
         DataSize64  = SamplesToDo-OutPos+1;
         DataSize64 *= increment;
@@ -568,7 +891,6 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
         if(Source->lSourceType == AL_STATIC)
         {
             const ALbuffer *ALBuffer = Source->queue->buffer;
-            const ALubyte *Data = ALBuffer->data;
             ALuint DataSize;
             ALuint pos;
 
@@ -597,8 +919,8 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
                 DataSize = ALBuffer->SampleLen - pos;
                 DataSize = minu(BufferSize, DataSize);
 
-                LoadStack(&SrcData[SrcDataSize*NumChannels], &Data[pos*FrameSize],
-                          ALBuffer->FmtType, DataSize*NumChannels);
+                LoadStack(&SrcData[SrcDataSize*NumChannels], ALBuffer,
+                          NumChannels, pos, DataSize);
                 SrcDataSize += DataSize;
                 BufferSize -= DataSize;
 
@@ -639,8 +961,8 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
                 DataSize = LoopEnd - pos;
                 DataSize = minu(BufferSize, DataSize);
 
-                LoadStack(&SrcData[SrcDataSize*NumChannels], &Data[pos*FrameSize],
-                          ALBuffer->FmtType, DataSize*NumChannels);
+                LoadStack(&SrcData[SrcDataSize*NumChannels], ALBuffer,
+                          NumChannels, pos, DataSize);
                 SrcDataSize += DataSize;
                 BufferSize -= DataSize;
 
@@ -649,8 +971,8 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
                 {
                     DataSize = minu(BufferSize, DataSize);
 
-                    LoadStack(&SrcData[SrcDataSize*NumChannels], &Data[LoopStart*FrameSize],
-                              ALBuffer->FmtType, DataSize*NumChannels);
+                    LoadStack(&SrcData[SrcDataSize*NumChannels], ALBuffer,
+                              NumChannels, LoopStart, DataSize);
                     SrcDataSize += DataSize;
                     BufferSize -= DataSize;
                 }
@@ -706,7 +1028,6 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
                 const ALbuffer *ALBuffer;
                 if((ALBuffer=tmpiter->buffer) != NULL)
                 {
-                    const ALubyte *Data = ALBuffer->data;
                     ALuint DataSize = ALBuffer->SampleLen;
 
                     /* Skip the data already played */
@@ -714,13 +1035,12 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
                         pos -= DataSize;
                     else
                     {
-                        Data += pos*FrameSize;
                         DataSize -= pos;
-                        pos -= pos;
 
                         DataSize = minu(BufferSize, DataSize);
-                        LoadStack(&SrcData[SrcDataSize*NumChannels], Data,
-                                  ALBuffer->FmtType, DataSize*NumChannels);
+                        LoadStack(&SrcData[SrcDataSize*NumChannels], ALBuffer,
+                                  NumChannels, pos, DataSize);
+                        pos -= pos;
                         SrcDataSize += DataSize;
                         BufferSize -= DataSize;
                     }
@@ -749,7 +1069,7 @@ ALvoid MixSource(ALsource *Source, ALCdevice *Device, ALuint SamplesToDo)
 
         SrcData += BufferPrePadding*NumChannels;
         Source->Params.DoMix(Source, Device, SrcData, &DataPosInt, &DataPosFrac,
-                             OutPos, SamplesToDo, BufferSize);
+                             increment, OutPos, SamplesToDo, BufferSize);
         OutPos += BufferSize;
 
         /* Handle looping sources */
@@ -174,7 +174,12 @@ ALvoid aluInitPanning(ALCdevice *Device)
     ALuint s;
 
     Speaker2Chan = Device->Speaker2Chan;
-    switch(Device->FmtChans)
+    if(Device->HrtfBus)
+    {
+        /* Pan into the virtual speakers of the HRTF bus */
+        Device->NumChan = GetHrtfBusSpeakers(Speaker2Chan, SpeakerAngle);
+    }
+    else switch(Device->FmtChans)
     {
         case DevFmtMono:
             Device->NumChan = 1;
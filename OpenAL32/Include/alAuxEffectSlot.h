@@ -11,6 +11,10 @@ extern "C" {
 
 typedef struct ALeffectState ALeffectState;
 
+/* Level below which an effect's input and tail are treated as silence
+ * (-100dB). */
+#define EFFECT_SILENCE_THRESHOLD  (0.00001f)
+
 typedef struct ALeffectslot
 {
     ALeffect effect;
@@ -26,6 +30,10 @@ typedef struct ALeffectslot
     ALfloat ClickRemoval[1];
     ALfloat PendingClicks[1];
 
+    // Samples left before the effect's tail decays below the silence
+    // threshold, once its input has gone silent
+    ALuint TailRemaining;
+
     RefCount ref;
 
     // Index to itself
@@ -43,6 +51,7 @@ struct ALeffectState {
     ALboolean (*DeviceUpdate)(ALeffectState *State, ALCdevice *Device);
     ALvoid (*Update)(ALeffectState *State, ALCdevice *Device, const ALeffectslot *Slot);
     ALvoid (*Process)(ALeffectState *State, ALuint SamplesToDo, const ALfloat *SamplesIn, ALfloat (*SamplesOut)[MAXCHANNELS]);
+    ALuint (*GetTailLength)(ALeffectState *State);
 };
 
 ALeffectState *NoneCreate(void);
@@ -55,6 +64,7 @@ ALeffectState *DedicatedCreate(void);
 #define ALeffectState_DeviceUpdate(a,b) ((a)->DeviceUpdate((a),(b)))
 #define ALeffectState_Update(a,b,c)     ((a)->Update((a),(b),(c)))
 #define ALeffectState_Process(a,b,c,d)  ((a)->Process((a),(b),(c),(d)))
+#define ALeffectState_GetTailLength(a)  ((a)->GetTailLength((a)))
 
 ALenum InitializeEffect(ALCdevice *Device, ALeffectslot *EffectSlot, ALeffect *effect);
 
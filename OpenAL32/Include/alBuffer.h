@@ -47,6 +47,7 @@ enum FmtType {
     FmtByte  = UserFmtByte,
     FmtShort = UserFmtShort,
     FmtFloat = UserFmtFloat,
+    FmtIMA4  = UserFmtIMA4, /* Kept as 36-byte blocks per channel, 65 frames each */
 };
 enum FmtChannels {
     FmtMono   = UserFmtMono,
@@ -65,10 +66,44 @@ static __inline ALuint FrameSizeFromFmt(enum FmtChannels chans, enum FmtType typ
     return ChannelsFromFmt(chans) * BytesFromFmt(type);
 }
 
+void DecodeIMA4Block(ALshort *dst, const ALubyte *src, ALint numchans);
+
+// Sample frames covered by each entry of a buffer's level envelope
+#define ENVELOPE_BLOCK_SIZE 256
+
+
+/* A copy of a buffer's samples resampled to the device rate, for sources that
+ * play it at its natural pitch. Sample j of the copy is the original sample at
+ * fixed-point position j*Step, so those sources mix it without interpolation. */
+typedef struct ALbufferCache
+{
+    // Source step the copy was made for, or 0 once it's out of date
+    volatile ALuint Step;
+    ALsizei SampleLen;
+    // Interleaved float samples
+    ALfloat *data;
+} ALbufferCache;
+
+enum ResampleCacheMode {
+    ResampleCacheNone,
+    ResampleCacheLazy,  // Made when the buffer is first set on a source
+    ResampleCacheEager  // Made when the buffer is loaded
+};
+
 
 typedef struct ALbuffer
 {
     ALvoid  *data;
+    // Set when data is not the buffer's own allocation (application memory
+    // given to alBufferDataStatic, or part of a file mapping), so it must
+    // never be resized or freed directly
+    ALboolean StaticData;
+    // Read-only file mapping holding data, unmapped when data is released
+    ALvoid  *Mapping;
+    size_t   MappingSize;
+    // Storage shared with other buffers holding the same samples, which data
+    // points into. It's copied before being written to
+    struct ALbufferStorage *Storage;
 
     ALsizei  Frequency;
     ALenum   Format;
@@ -84,14 +119,49 @@ typedef struct ALbuffer
     ALsizei  LoopStart;
     ALsizei  LoopEnd;
 
+    // Peak and RMS level of each ENVELOPE_BLOCK_SIZE frames over all
+    // channels, scaled to 0-65535 and rounded up, so only digital silence has
+    // a peak of 0. NULL when not measured, as for application memory that may
+    // change without the buffer knowing, or file mappings that are only paged
+    // in as they're played
+    ALushort (*Envelope)[2];
+
+    // Resampled copy for the device rate, made or replaced only while no
+    // source uses the buffer
+    ALbufferCache *Resampled;
+
     RefCount ref; // Number of sources using this buffer (deletion can only occur when this is 0)
 
     RWLock lock;
 
+    // Set while a queued asynchronous upload is still filling data
+    volatile ALenum UploadPending;
+
     // Index to itself
     ALuint buffer;
 } ALbuffer;
 
+// Whether sources given a buffer with a pending upload wait for it, rather
+// than rejecting it
+extern ALboolean WaitPendingBuffers;
+
+// Whether buffers loaded with identical samples share their storage
+extern ALboolean ShareBufferData;
+
+// Number of threads converting buffer data, and the number of sample frames
+// a conversion needs before it's split between them
+#define MAX_CONVERT_THREADS 16
+extern ALuint ConvertThreads;
+extern ALuint ConvertThreshold;
+
+// When buffers get a resampled copy for the device rate
+extern enum ResampleCacheMode BufferResampleCache;
+
+ALvoid WaitForBufferUpload(ALbuffer *buffer);
+ALenum ImportBuffer(ALbuffer *ALBuf, ALbuffer *src);
+ALvoid StopBufferUploads(void);
+ALvoid PrepareResampledBuffer(ALbuffer *ALBuf, ALuint DeviceFreq);
+
 ALvoid ReleaseALBuffers(ALCdevice *device);
 
 #ifdef __cplusplus
@@ -20,6 +20,7 @@ extern ALboolean DisabledEffects[MAX_EFFECTS];
 
 extern ALfloat ReverbBoost;
 extern ALboolean EmulateEAXReverb;
+extern ALuint ReverbRateShift;
 
 typedef struct ALeffect
 {
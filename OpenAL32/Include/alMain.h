@@ -342,6 +342,7 @@ static __inline void UnlockUIntMapWrite(UIntMap *map)
 { WriteUnlock(&map->lock); }
 
 #include "alListener.h"
+#include "alBuffer.h"
 #include "alu.h"
 
 #ifdef __cplusplus
@@ -359,6 +360,8 @@ extern "C" {
 
 
 struct Hrtf;
+struct HrtfCache;
+struct HrtfBus;
 
 
 // Find the next power-of-2 for non-power-of-2 numbers.
@@ -557,6 +560,9 @@ struct ALCdevice_struct
 
     // Map of Buffers for this device
     UIntMap BufferMap;
+    // Sample type (FmtByte, FmtShort or FmtFloat) that buffer data the mixer
+    // can't read directly is converted to
+    enum FmtType BufferStorageType;
 
     // Map of Effects for this device
     UIntMap EffectMap;
@@ -566,6 +572,11 @@ struct ALCdevice_struct
 
     /* HRTF filter tables */
     const struct Hrtf *Hrtf;
+    /* Interpolated HRIRs for recently used directions */
+    struct HrtfCache *HrtfCache;
+    /* Virtual speakers convolved for the whole device, instead of HRTF per
+     * source */
+    struct HrtfBus *HrtfBus;
 
     // Stereo-to-binaural filter
     struct bs2b *Bs2b;
@@ -655,6 +666,10 @@ struct ALCcontext_struct
     ALsizei           ActiveSourceCount;
     ALsizei           MaxActiveSources;
 
+    // Blocks the sources are allocated from, and their unused sources
+    struct ALsourceBlock *SourceBlocks;
+    struct ALsource      *FreeSources;
+
     struct ALeffectslot **ActiveEffectSlots;
     ALsizei               ActiveEffectSlotCount;
     ALsizei               MaxActiveEffectSlots;
@@ -711,6 +726,20 @@ int ConfigValueFloat(const char *blockName, const char *keyName, float *ret);
 
 void SetRTPriority(void);
 
+/* Alignment for data the mixer goes over every update, to keep it from
+ * straddling cache lines */
+#define CACHE_LINE_SIZE 64
+
+void *al_malloc(size_t alignment, size_t size);
+void *al_calloc(size_t alignment, size_t size);
+void al_free(void *ptr);
+
+ALuint GetProcessorCount(void);
+
+void *MapFileToMem(const char *fname, size_t *retlen);
+void *MapFdToMem(int fd, size_t *retlen);
+void UnmapFileMem(void *ptr, size_t len);
+
 void SetDefaultChannelOrder(ALCdevice *device);
 void SetDefaultWFXChannelOrder(ALCdevice *device);
 
@@ -720,12 +749,15 @@ const ALCchar *DevFmtChannelsString(enum DevFmtChannels chans);
 #define HRIR_BITS        (5)
 #define HRIR_LENGTH      (1<<HRIR_BITS)
 #define HRIR_MASK        (HRIR_LENGTH-1)
-void InitHrtf(void);
 void FreeHrtf(void);
 const struct Hrtf *GetHrtf(ALCdevice *device);
+struct HrtfCache *CreateHrtfCache(void);
+struct HrtfBus *CreateHrtfBus(const struct Hrtf *Hrtf);
+ALuint GetHrtfBusSpeakers(enum Channel *Speaker2Chan, ALfloat *SpeakerAngle);
+void ApplyHrtfBus(struct HrtfBus *Bus, ALfloat (*RESTRICT DryBuffer)[MAXCHANNELS], ALuint SamplesToDo);
 ALfloat CalcHrtfDelta(ALfloat oldGain, ALfloat newGain, const ALfloat olddir[3], const ALfloat newdir[3]);
-void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays);
-ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep);
+void GetLerpedHrtfCoeffs(const struct Hrtf *Hrtf, struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat (*coeffs)[2], ALuint *delays);
+ALuint GetMovingHrtfCoeffs(const struct Hrtf *Hrtf, struct HrtfCache *Cache, ALfloat elevation, ALfloat azimuth, ALfloat gain, ALfloat delta, ALint counter, ALfloat (*coeffs)[2], ALuint *delays, ALfloat (*coeffStep)[2], ALint *delayStep);
 
 void al_print(const char *func, const char *fmt, ...) PRINTF_STYLE(2,3);
 #define AL_PRINT(...) al_print(__FUNCTION__, __VA_ARGS__)
@@ -15,12 +15,38 @@ extern "C" {
 #define SRC_HISTORY_LENGTH (1<<SRC_HISTORY_BITS)
 #define SRC_HISTORY_MASK   (SRC_HISTORY_LENGTH-1)
 
+/* Level below which a source's filter and HRTF history is treated as silence
+ * (-100dB). */
+#define SRC_SILENCE_THRESHOLD (0.00001f)
+
 extern enum Resampler DefaultResampler;
 
 extern const ALsizei ResamplerPadding[ResamplerMax];
 extern const ALsizei ResamplerPrePadding[ResamplerMax];
 
 
+enum HrtfLod {
+    HrtfLodFull,    // Mixed with HRTF
+    HrtfLodFading,  // HRTF mixer stepping to the panned gains
+    HrtfLodPanned   // Mixed with the panned gains
+};
+
+
+/* HRTF mixing state. It's kept out of the source, and only allocated for
+ * sources played on a device using HRTF. */
+typedef struct ALhrtfState
+{
+    ALfloat History[MAXCHANNELS][SRC_HISTORY_LENGTH];
+    ALfloat Values[MAXCHANNELS][HRIR_LENGTH][2];
+
+    /* Current target HRIRs, and their steps while moving */
+    ALfloat Coeffs[MAXCHANNELS][HRIR_LENGTH][2];
+    ALuint Delay[MAXCHANNELS][2];
+    ALfloat CoeffStep[HRIR_LENGTH][2];
+    ALint DelayStep[2];
+} ALhrtfState;
+
+
 typedef struct ALbufferlistitem
 {
     struct ALbuffer         *buffer;
@@ -30,6 +56,60 @@ typedef struct ALbufferlistitem
 
 typedef struct ALsource
 {
+    /* Mixer state. The mixer goes over these for every active source on
+     * every update, so they're kept together at the start of the source,
+     * which is placed on a cache line boundary. */
+    volatile ALenum state;
+    volatile ALenum NeedsUpdate;
+    ALuint position;
+    ALuint position_fraction;
+
+    ALbufferlistitem *queue; // Linked list of buffers in queue
+    ALuint BuffersInQueue;   // Number of buffers in queue
+    ALuint BuffersPlayed;    // Number of buffers played on this loop
+
+    volatile ALboolean bLooping;
+    // Source Type (Static, Streaming, or Undetermined)
+    volatile ALint lSourceType;
+
+    ALuint NumChannels;
+    enum Resampler Resampler;
+
+    /* HRTF info */
+    ALhrtfState *HrtfState;
+    ALboolean HrtfMoving;
+    ALuint HrtfCounter;
+    ALuint HrtfOffset;
+
+    /* Current target parameters used for mixing */
+    struct {
+        MixerFunc DoMix;
+        /* Point mixer for a buffer's copy resampled to the device rate */
+        MixerFunc DoMixPoint;
+
+        ALint Step;
+
+        /* A mixing matrix. First subscript is the channel number of the input
+         * data (regardless of channel configuration) and the second is the
+         * channel target (eg. FRONT_LEFT) */
+        ALfloat DryGains[MAXCHANNELS][MAXCHANNELS];
+
+        FILTER iirFilter;
+        ALfloat history[MAXCHANNELS*2];
+
+        struct {
+            struct ALeffectslot *Slot;
+            ALfloat WetGain;
+            FILTER iirFilter;
+            ALfloat history[MAXCHANNELS];
+        } Send[MAX_SENDS];
+
+        /* Last HRTF target, only used when updating */
+        ALfloat HrtfGain;
+        ALfloat HrtfDir[3];
+    } Params;
+
+    /* Everything below is only read when the source's properties change. */
     volatile ALfloat   flPitch;
     volatile ALfloat   flGain;
     volatile ALfloat   flOuterGain;
@@ -44,20 +124,14 @@ typedef struct ALsource
     volatile ALfloat   vVelocity[3];
     volatile ALfloat   vOrientation[3];
     volatile ALboolean bHeadRelative;
-    volatile ALboolean bLooping;
     volatile enum DistanceModel DistanceModel;
     volatile ALboolean DirectChannels;
+    volatile ALint     Priority;
 
-    enum Resampler Resampler;
+    enum Resampler LodResampler;
+    enum HrtfLod HrtfLod;
 
-    volatile ALenum state;
     ALenum new_state;
-    ALuint position;
-    ALuint position_fraction;
-
-    ALbufferlistitem *queue; // Linked list of buffers in queue
-    ALuint BuffersInQueue;   // Number of buffers in queue
-    ALuint BuffersPlayed;    // Number of buffers played on this loop
 
     ALfloat DirectGain;
     ALfloat DirectGainHF;
@@ -80,51 +154,11 @@ typedef struct ALsource
     ALint lOffset;
     ALint lOffsetType;
 
-    // Source Type (Static, Streaming, or Undetermined)
-    volatile ALint lSourceType;
-
-    ALuint NumChannels;
-    ALuint SampleSize;
-
-    /* HRTF info */
-    ALboolean HrtfMoving;
-    ALuint HrtfCounter;
-    ALfloat HrtfHistory[MAXCHANNELS][SRC_HISTORY_LENGTH];
-    ALfloat HrtfValues[MAXCHANNELS][HRIR_LENGTH][2];
-    ALuint HrtfOffset;
-
-    /* Current target parameters used for mixing */
-    struct {
-        MixerFunc DoMix;
-
-        ALint Step;
-
-        ALfloat HrtfGain;
-        ALfloat HrtfDir[3];
-        ALfloat HrtfCoeffs[MAXCHANNELS][HRIR_LENGTH][2];
-        ALuint HrtfDelay[MAXCHANNELS][2];
-        ALfloat HrtfCoeffStep[HRIR_LENGTH][2];
-        ALint HrtfDelayStep[2];
-
-        /* A mixing matrix. First subscript is the channel number of the input
-         * data (regardless of channel configuration) and the second is the
-         * channel target (eg. FRONT_LEFT) */
-        ALfloat DryGains[MAXCHANNELS][MAXCHANNELS];
-
-        FILTER iirFilter;
-        ALfloat history[MAXCHANNELS*2];
-
-        struct {
-            struct ALeffectslot *Slot;
-            ALfloat WetGain;
-            FILTER iirFilter;
-            ALfloat history[MAXCHANNELS];
-        } Send[MAX_SENDS];
-    } Params;
-    volatile ALenum NeedsUpdate;
-
     ALvoid (*Update)(struct ALsource *self, const ALCcontext *context);
 
+    // Next unused source in the context's free list
+    struct ALsource *NextFree;
+
     // Index to itself
     ALuint source;
 } ALsource;
@@ -134,6 +168,7 @@ ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state);
 ALboolean ApplyOffset(ALsource *Source);
 
 ALvoid ReleaseALSources(ALCcontext *Context);
+ALvoid ReleaseALSourceBlocks(ALCcontext *Context);
 
 #ifdef __cplusplus
 }
@@ -123,8 +123,8 @@ struct ALbuffer;
 typedef ALvoid (*MixerFunc)(struct ALsource *self, ALCdevice *Device,
                             const ALvoid *RESTRICT data,
                             ALuint *DataPosInt, ALuint *DataPosFrac,
-                            ALuint OutPos, ALuint SamplesToDo,
-                            ALuint BufferSize);
+                            ALuint increment, ALuint OutPos,
+                            ALuint SamplesToDo, ALuint BufferSize);
 
 enum Resampler {
     PointResampler,
@@ -304,6 +304,15 @@ ALvoid aluHandleDisconnect(ALCdevice *device);
 
 extern ALfloat ConeScale;
 extern ALfloat ZScale;
+extern ALboolean CoalesceEffectSlots;
+extern ALfloat HrtfLodGain;
+extern ALfloat HrtfLodDistance;
+extern ALint HrtfLodPriority;
+extern ALboolean ResamplerLod;
+extern ALfloat ResamplerLodGain;
+extern ALfloat ResamplerLodPointGain;
+extern ALfloat ResamplerLodDistance;
+extern ALint ResamplerLodPriority;
 
 #ifdef __cplusplus
 }
@@ -49,6 +49,12 @@
 /* Define if we have the stat function */
 #define HAVE_STAT
 
+/* Define if we have sys/mman.h */
+#define HAVE_SYS_MMAN_H
+
+/* Define if we have the posix_memalign function */
+#define HAVE_POSIX_MEMALIGN
+
 /* Define if we have the powf function */
 #define HAVE_POWF
 
@@ -101,6 +107,9 @@
 /* Define if we have arm_neon.h */
 #define HAVE_ARM_NEON_H
 
+/* Define if we have xmmintrin.h */
+#define HAVE_XMMINTRIN_H
+
 /* Define if we have guiddef.h */
 /* #undef HAVE_GUIDDEF_H */
 
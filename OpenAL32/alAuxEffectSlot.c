@@ -444,6 +444,11 @@ static ALvoid NoneProcess(ALeffectState *State, ALuint SamplesToDo, const ALfloa
     (void)SamplesIn;
     (void)SamplesOut;
 }
+static ALuint NoneGetTailLength(ALeffectState *State)
+{
+    (void)State;
+    return 0;
+}
 ALeffectState *NoneCreate(void)
 {
     ALeffectState *state;
@@ -456,6 +461,7 @@ ALeffectState *NoneCreate(void)
     state->DeviceUpdate = NoneDeviceUpdate;
     state->Update = NoneUpdate;
     state->Process = NoneProcess;
+    state->GetTailLength = NoneGetTailLength;
 
     return state;
 }
@@ -559,6 +565,7 @@ ALenum InitializeEffect(ALCdevice *Device, ALeffectslot *EffectSlot, ALeffect *e
             return AL_OUT_OF_MEMORY;
         }
         State = ExchangePtr((XchgPtr*)&EffectSlot->EffectState, State);
+        EffectSlot->TailRemaining = 0;
 
         if(!effect)
             memset(&EffectSlot->effect, 0, sizeof(EffectSlot->effect));
@@ -607,6 +614,7 @@ ALenum InitEffectSlot(ALeffectslot *slot)
         slot->ClickRemoval[i] = 0.0f;
         slot->PendingClicks[i] = 0.0f;
     }
+    slot->TailRemaining = 0;
     slot->ref = 0;
 
     return AL_NO_ERROR;
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 
 #include "alMain.h"
 #include "AL/al.h"
@@ -33,8 +34,24 @@
 #include "alThunk.h"
 
 
-static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels chans, enum UserFmtType type, const ALvoid *data, ALboolean storesrc);
+static ALenum LoadUserData(ALbuffer *ALBuf, enum FmtType StoreType, ALuint freq, ALenum format, const ALvoid *data, ALsizei size, ALboolean async);
+static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels chans, enum UserFmtType type, const ALvoid *data, ALboolean storesrc, ALboolean async);
+static ALenum LoadStaticData(ALbuffer *ALBuf, ALuint freq, ALenum format, ALvoid *data, ALsizei size, ALvoid *mapping, size_t mapsize);
+static ALenum LoadFile(ALbuffer *ALBuf, enum FmtType StoreType, ALubyte *mapping, size_t mapsize, ALenum format, ALsizei freq);
+static void FreeBufferData(ALbuffer *ALBuf);
+static enum FmtType StorageType(enum UserFmtType SrcType, enum FmtType StoreType);
+static ALenum StorageFormat(enum UserFmtChannels chans, enum FmtType type);
+static void MeasureEnvelope(ALbuffer *ALBuf);
+static void UpdateEnvelope(ALbuffer *ALBuf, ALsizei start, ALsizei end);
+static void MarkEnvelope(ALbuffer *ALBuf, ALsizei start, ALsizei end);
+static void FreeResampled(ALbuffer *ALBuf);
+static void ShareStorage(ALbuffer *ALBuf, size_t size);
+static ALboolean MakeBufferDataUnique(ALbuffer *ALBuf, struct ALbufferStorage **old);
+static void DropOldStorage(ALCcontext *context, struct ALbufferStorage *storage);
+static void ReleaseStorage(struct ALbufferStorage *storage);
+static ALboolean ClaimStorage(ALbuffer *ALBuf);
 static void ConvertData(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src, enum UserFmtType srcType, ALsizei numchans, ALsizei len);
+static void ConvertDataParallel(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src, enum UserFmtType srcType, ALsizei numchans, ALsizei len);
 static ALboolean IsValidType(ALenum type);
 static ALboolean IsValidChannels(ALenum channels);
 static ALboolean DecomposeUserFormat(ALenum format, enum UserFmtChannels *chans, enum UserFmtType *type);
@@ -180,6 +197,61 @@ static const char aLawCompressTable[128] = {
     7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7
 };
 
+ALboolean WaitPendingBuffers = AL_TRUE;
+
+ALuint ConvertThreads = 1;
+ALuint ConvertThreshold = 262144;
+
+ALboolean ShareBufferData = AL_FALSE;
+
+enum ResampleCacheMode BufferResampleCache = ResampleCacheNone;
+
+/* Sinc taps either side of a resampled sample, when not lowering the rate,
+ * and the steps between taps the filter kernel is tabulated at */
+#define RESAMPLE_HALF_TAPS 8
+#define RESAMPLE_PHASES    256
+
+/* Sample storage shared by buffers loaded with the same data, found by a hash
+ * of its contents, or by buffers imported from another. Storage holding part
+ * of a file mapping isn't hashed, so the file is only paged in as it's
+ * played. The table and the reference counts are guarded by StorageLock. */
+typedef struct ALbufferStorage {
+    ALvoid *data;
+    size_t size;
+    ALvoid *Mapping;
+    size_t MappingSize;
+    ALboolean Hashed;
+    ALuint hash;
+    ALuint ref;
+
+    struct ALbufferStorage *next;
+} ALbufferStorage;
+
+#define STORAGE_TABLE_SIZE 256
+static ALbufferStorage *StorageTable[STORAGE_TABLE_SIZE];
+static RWLock StorageLock;
+
+/* Conversions queued by alBufferDataAsyncSOFT. They are run in order by a
+ * worker thread that is started when needed and exits once the queue is
+ * empty. */
+typedef struct ALbufferUpload {
+    ALbuffer *buffer;
+
+    ALvoid *dst;
+    enum UserFmtType DstType;
+    const ALvoid *src;
+    enum UserFmtType SrcType;
+    ALsizei NumChans;
+    ALsizei Frames;
+
+    struct ALbufferUpload *next;
+} ALbufferUpload;
+
+static ALbufferUpload *UploadQueue;
+static ALvoid *UploadThread;
+static ALboolean UploadThreadRunning;
+static RWLock UploadLock;
+
 
 /*
  *    alGenBuffers(ALsizei n, ALuint *buffers)
@@ -285,8 +357,10 @@ AL_API ALvoid AL_APIENTRY alDeleteBuffers(ALsizei n, const ALuint *buffers)
                 continue;
             FreeThunkEntry(ALBuf->buffer);
 
-            /* Release the memory used to store audio data */
-            free(ALBuf->data);
+            /* Release the memory used to store audio data, once any pending
+             * upload is done writing to it */
+            WaitForBufferUpload(ALBuf);
+            FreeBufferData(ALBuf);
 
             /* Release buffer structure */
             memset(ALBuf, 0, sizeof(ALbuffer));
@@ -326,12 +400,8 @@ AL_API ALboolean AL_APIENTRY alIsBuffer(ALuint buffer)
  */
 AL_API ALvoid AL_APIENTRY alBufferData(ALuint buffer,ALenum format,const ALvoid *data,ALsizei size,ALsizei freq)
 {
-    enum UserFmtChannels SrcChannels;
-    enum UserFmtType SrcType;
     ALCcontext *Context;
     ALCdevice *device;
-    ALuint FrameSize;
-    ALenum NewFormat;
     ALbuffer *ALBuf;
     ALenum err;
 
@@ -343,99 +413,163 @@ AL_API ALvoid AL_APIENTRY alBufferData(ALuint buffer,ALenum format,const ALvoid
         alSetError(Context, AL_INVALID_NAME);
     else if(size < 0 || freq < 0)
         alSetError(Context, AL_INVALID_VALUE);
-    else if(DecomposeUserFormat(format, &SrcChannels, &SrcType) == AL_FALSE)
-        alSetError(Context, AL_INVALID_ENUM);
-    else switch(SrcType)
+    else
     {
-        case UserFmtByte:
-        case UserFmtUByte:
-        case UserFmtShort:
-        case UserFmtUShort:
-        case UserFmtInt:
-        case UserFmtUInt:
-        case UserFmtFloat:
-            FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
-            if((size%FrameSize) != 0)
-                err = AL_INVALID_VALUE;
-            else
-                err = LoadData(ALBuf, freq, format, size/FrameSize,
-                               SrcChannels, SrcType, data, AL_TRUE);
-            if(err != AL_NO_ERROR)
-                alSetError(Context, err);
-            break;
+        err = LoadUserData(ALBuf, device->BufferStorageType, freq, format,
+                           data, size, AL_FALSE);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+        else if(BufferResampleCache == ResampleCacheEager)
+            PrepareResampledBuffer(ALBuf, device->Frequency);
+    }
 
-        case UserFmtByte3:
-        case UserFmtUByte3:
-        case UserFmtDouble:
-            FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
-            NewFormat = AL_FORMAT_MONO_FLOAT32;
-            switch(SrcChannels)
-            {
-                case UserFmtMono: NewFormat = AL_FORMAT_MONO_FLOAT32; break;
-                case UserFmtStereo: NewFormat = AL_FORMAT_STEREO_FLOAT32; break;
-                case UserFmtRear: NewFormat = AL_FORMAT_REAR32; break;
-                case UserFmtQuad: NewFormat = AL_FORMAT_QUAD32; break;
-                case UserFmtX51: NewFormat = AL_FORMAT_51CHN32; break;
-                case UserFmtX61: NewFormat = AL_FORMAT_61CHN32; break;
-                case UserFmtX71: NewFormat = AL_FORMAT_71CHN32; break;
-            }
-            if((size%FrameSize) != 0)
-                err = AL_INVALID_VALUE;
-            else
-                err = LoadData(ALBuf, freq, NewFormat, size/FrameSize,
-                               SrcChannels, SrcType, data, AL_TRUE);
-            if(err != AL_NO_ERROR)
-                alSetError(Context, err);
-            break;
+    ALCcontext_DecRef(Context);
+}
 
-        case UserFmtMulaw:
-        case UserFmtAlaw:
-            FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
-            NewFormat = AL_FORMAT_MONO16;
-            switch(SrcChannels)
-            {
-                case UserFmtMono: NewFormat = AL_FORMAT_MONO16; break;
-                case UserFmtStereo: NewFormat = AL_FORMAT_STEREO16; break;
-                case UserFmtRear: NewFormat = AL_FORMAT_REAR16; break;
-                case UserFmtQuad: NewFormat = AL_FORMAT_QUAD16; break;
-                case UserFmtX51: NewFormat = AL_FORMAT_51CHN16; break;
-                case UserFmtX61: NewFormat = AL_FORMAT_61CHN16; break;
-                case UserFmtX71: NewFormat = AL_FORMAT_71CHN16; break;
-            }
-            if((size%FrameSize) != 0)
-                err = AL_INVALID_VALUE;
-            else
-                err = LoadData(ALBuf, freq, NewFormat, size/FrameSize,
-                               SrcChannels, SrcType, data, AL_TRUE);
-            if(err != AL_NO_ERROR)
-                alSetError(Context, err);
-            break;
+/*
+ *    alBufferDataAsyncSOFT(ALuint buffer, ALenum format, const ALvoid *data,
+ *                          ALsizei size, ALsizei freq)
+ *
+ *    Like alBufferData, but the samples are converted on a worker thread and
+ *    the call returns once the buffer's storage is set up. The data must stay
+ *    valid until AL_BUFFER_READY_SOFTX reports the buffer as ready.
+ */
+AL_API ALvoid AL_APIENTRY alBufferDataAsyncSOFT(ALuint buffer,ALenum format,const ALvoid *data,ALsizei size,ALsizei freq)
+{
+    ALCcontext *Context;
+    ALCdevice *device;
+    ALbuffer *ALBuf;
+    ALenum err;
 
-        case UserFmtIMA4: {
-            /* Here is where things vary:
-             * nVidia and Apple use 64+1 sample frames per block -> block_size=36 bytes per channel
-             * Most PC sound software uses 2040+1 sample frames per block -> block_size=1024 bytes per channel
-             */
-            ALuint FrameSize = ChannelsFromUserFmt(SrcChannels) * 36;
-            ALenum NewFormat = AL_FORMAT_MONO16;
-            switch(SrcChannels)
-            {
-                case UserFmtMono: NewFormat = AL_FORMAT_MONO16; break;
-                case UserFmtStereo: NewFormat = AL_FORMAT_STEREO16; break;
-                case UserFmtRear: NewFormat = AL_FORMAT_REAR16; break;
-                case UserFmtQuad: NewFormat = AL_FORMAT_QUAD16; break;
-                case UserFmtX51: NewFormat = AL_FORMAT_51CHN16; break;
-                case UserFmtX61: NewFormat = AL_FORMAT_61CHN16; break;
-                case UserFmtX71: NewFormat = AL_FORMAT_71CHN16; break;
-            }
-            if((size%FrameSize) != 0)
-                err = AL_INVALID_VALUE;
-            else
-                err = LoadData(ALBuf, freq, NewFormat, size/FrameSize*65,
-                               SrcChannels, SrcType, data, AL_TRUE);
-            if(err != AL_NO_ERROR)
-                alSetError(Context, err);
-        }   break;
+    Context = GetContextRef();
+    if(!Context) return;
+
+    device = Context->Device;
+    if((ALBuf=LookupBuffer(device, buffer)) == NULL)
+        alSetError(Context, AL_INVALID_NAME);
+    else if(size < 0 || freq < 0)
+        alSetError(Context, AL_INVALID_VALUE);
+    else
+    {
+        err = LoadUserData(ALBuf, device->BufferStorageType, freq, format,
+                           data, size, AL_TRUE);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+    }
+
+    ALCcontext_DecRef(Context);
+}
+
+/*
+ *    alBufferDataStatic(const ALint buffer, ALenum format, ALvoid *data,
+ *                       ALsizei len, ALsizei freq)
+ *
+ *    Make the buffer use the application's memory for its samples, without
+ *    copying it. The format must be one the mixer can read directly (16-bit,
+ *    float, or IMA4). The memory must stay valid until the buffer is deleted
+ *    or given new data, both of which fail while any source still uses the
+ *    buffer.
+ */
+AL_API ALvoid AL_APIENTRY alBufferDataStatic(const ALint buffer, ALenum format, ALvoid *data, ALsizei len, ALsizei freq)
+{
+    ALCcontext *Context;
+    ALCdevice *device;
+    ALbuffer *ALBuf;
+    ALenum err;
+
+    Context = GetContextRef();
+    if(!Context) return;
+
+    device = Context->Device;
+    if((ALBuf=LookupBuffer(device, buffer)) == NULL)
+        alSetError(Context, AL_INVALID_NAME);
+    else if(len < 0 || freq <= 0 || (len > 0 && data == NULL))
+        alSetError(Context, AL_INVALID_VALUE);
+    else
+    {
+        err = LoadStaticData(ALBuf, freq, format, data, len, NULL, 0);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+    }
+
+    ALCcontext_DecRef(Context);
+}
+
+/*
+ *    alBufferFileSOFT(ALuint buffer, const ALchar *filename, ALenum format,
+ *                     ALsizei freq)
+ *
+ *    Load a sound file into the buffer. With a format of AL_NONE the file is
+ *    read as a RIFF WAVE file, otherwise all of it is taken as raw samples of
+ *    the given format and frequency. Samples the mixer can read as they are
+ *    stay in a read-only mapping of the file, so nothing is copied and
+ *    processes loading the same file share its pages.
+ */
+AL_API void AL_APIENTRY alBufferFileSOFT(ALuint buffer, const ALchar *filename, ALenum format, ALsizei freq)
+{
+    ALCcontext *Context;
+    ALCdevice *device;
+    ALbuffer *ALBuf;
+    ALvoid *mapping;
+    size_t mapsize;
+    ALenum err;
+
+    Context = GetContextRef();
+    if(!Context) return;
+
+    device = Context->Device;
+    if((ALBuf=LookupBuffer(device, buffer)) == NULL)
+        alSetError(Context, AL_INVALID_NAME);
+    else if(!filename || (format != AL_NONE && freq <= 0))
+        alSetError(Context, AL_INVALID_VALUE);
+    else if((mapping=MapFileToMem(filename, &mapsize)) == NULL)
+        alSetError(Context, AL_INVALID_VALUE);
+    else
+    {
+        err = LoadFile(ALBuf, device->BufferStorageType, mapping, mapsize,
+                       format, freq);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+        else if(BufferResampleCache == ResampleCacheEager)
+            PrepareResampledBuffer(ALBuf, device->Frequency);
+    }
+
+    ALCcontext_DecRef(Context);
+}
+
+/*
+ *    alBufferFileDescriptorSOFT(ALuint buffer, ALint fd, ALenum format,
+ *                               ALsizei freq)
+ *
+ *    As alBufferFileSOFT, for an open file. The descriptor is not closed.
+ */
+AL_API void AL_APIENTRY alBufferFileDescriptorSOFT(ALuint buffer, ALint fd, ALenum format, ALsizei freq)
+{
+    ALCcontext *Context;
+    ALCdevice *device;
+    ALbuffer *ALBuf;
+    ALvoid *mapping;
+    size_t mapsize;
+    ALenum err;
+
+    Context = GetContextRef();
+    if(!Context) return;
+
+    device = Context->Device;
+    if((ALBuf=LookupBuffer(device, buffer)) == NULL)
+        alSetError(Context, AL_INVALID_NAME);
+    else if(fd < 0 || (format != AL_NONE && freq <= 0))
+        alSetError(Context, AL_INVALID_VALUE);
+    else if((mapping=MapFdToMem(fd, &mapsize)) == NULL)
+        alSetError(Context, AL_INVALID_VALUE);
+    else
+    {
+        err = LoadFile(ALBuf, device->BufferStorageType, mapping, mapsize,
+                       format, freq);
+        if(err != AL_NO_ERROR)
+            alSetError(Context, err);
+        else if(BufferResampleCache == ResampleCacheEager)
+            PrepareResampledBuffer(ALBuf, device->Frequency);
     }
 
     ALCcontext_DecRef(Context);
@@ -467,9 +601,11 @@ AL_API ALvoid AL_APIENTRY alBufferSubDataSOFT(ALuint buffer,ALenum format,const
         alSetError(Context, AL_INVALID_ENUM);
     else
     {
+        ALbufferStorage *storage = NULL;
         ALuint original_align;
 
         WriteLock(&ALBuf->lock);
+        WaitForBufferUpload(ALBuf);
 
         original_align = ((ALBuf->OriginalType == UserFmtIMA4) ?
                           (ChannelsFromUserFmt(ALBuf->OriginalChannels)*36) :
@@ -478,16 +614,27 @@ AL_API ALvoid AL_APIENTRY alBufferSubDataSOFT(ALuint buffer,ALenum format,const
 
         if(SrcChannels != ALBuf->OriginalChannels || SrcType != ALBuf->OriginalType)
             alSetError(Context, AL_INVALID_ENUM);
+        else if(ALBuf->Mapping)
+            alSetError(Context, AL_INVALID_OPERATION);
         else if(offset > ALBuf->OriginalSize ||
                 length > ALBuf->OriginalSize-offset ||
                 (offset%original_align) != 0 ||
                 (length%original_align) != 0)
             alSetError(Context, AL_INVALID_VALUE);
+        else if(MakeBufferDataUnique(ALBuf, &storage) == AL_FALSE)
+            alSetError(Context, AL_OUT_OF_MEMORY);
         else
         {
             ALuint Channels = ChannelsFromFmt(ALBuf->FmtChannels);
             ALuint Bytes = BytesFromFmt(ALBuf->FmtType);
-            if(SrcType == UserFmtIMA4)
+            ALsizei start;
+            if(ALBuf->FmtType == FmtIMA4)
+            {
+                /* offset is already a byte offset, length -> sample count */
+                length /= original_align;
+                length *= 65;
+            }
+            else if(SrcType == UserFmtIMA4)
             {
                 /* offset -> byte offset, length -> sample count */
                 offset /= 36;
@@ -504,10 +651,24 @@ AL_API ALvoid AL_APIENTRY alBufferSubDataSOFT(ALuint buffer,ALenum format,const
                 offset *= Bytes;
                 length /= OldBytes * Channels;
             }
+
+            /* Keep the mixer from skipping the blocks while they change */
+            if(ALBuf->FmtType == FmtIMA4)
+                start = offset/(36*Channels) * 65;
+            else
+                start = offset/(Bytes*Channels);
+            MarkEnvelope(ALBuf, start, start+length);
+            if(ALBuf->Resampled)
+                ALBuf->Resampled->Step = 0;
+
             ConvertData(&((ALubyte*)ALBuf->data)[offset], ALBuf->FmtType,
                         data, SrcType, Channels, length);
+            UpdateEnvelope(ALBuf, start, start+length);
         }
         WriteUnlock(&ALBuf->lock);
+
+        if(storage)
+            DropOldStorage(Context, storage);
     }
 
     ALCcontext_DecRef(Context);
@@ -536,7 +697,7 @@ AL_API void AL_APIENTRY alBufferSamplesSOFT(ALuint buffer,
     else
     {
         err = LoadData(ALBuf, samplerate, internalformat, samples,
-                       channels, type, data, AL_FALSE);
+                       channels, type, data, AL_FALSE, AL_FALSE);
         if(err != AL_NO_ERROR)
             alSetError(Context, err);
     }
@@ -564,23 +725,45 @@ AL_API void AL_APIENTRY alBufferSubSamplesSOFT(ALuint buffer,
         alSetError(Context, AL_INVALID_ENUM);
     else
     {
+        ALbufferStorage *storage = NULL;
         ALuint FrameSize;
 
         WriteLock(&ALBuf->lock);
+        WaitForBufferUpload(ALBuf);
         FrameSize = FrameSizeFromFmt(ALBuf->FmtChannels, ALBuf->FmtType);
         if(channels != (ALenum)ALBuf->FmtChannels)
             alSetError(Context, AL_INVALID_ENUM);
+        else if(ALBuf->Mapping)
+            alSetError(Context, AL_INVALID_OPERATION);
         else if(offset > ALBuf->SampleLen || samples > ALBuf->SampleLen-offset)
             alSetError(Context, AL_INVALID_VALUE);
+        else if(ALBuf->FmtType == FmtIMA4 && ((offset%65) != 0 || (samples%65) != 0))
+            alSetError(Context, AL_INVALID_VALUE);
+        else if(MakeBufferDataUnique(ALBuf, &storage) == AL_FALSE)
+            alSetError(Context, AL_OUT_OF_MEMORY);
         else
         {
+            ALsizei start = offset;
+
+            /* Keep the mixer from skipping the blocks while they change */
+            MarkEnvelope(ALBuf, start, start+samples);
+            if(ALBuf->Resampled)
+                ALBuf->Resampled->Step = 0;
+
             /* offset -> byte offset */
-            offset *= FrameSize;
+            if(ALBuf->FmtType == FmtIMA4)
+                offset = offset/65 * 36*ChannelsFromFmt(ALBuf->FmtChannels);
+            else
+                offset *= FrameSize;
             ConvertData(&((ALubyte*)ALBuf->data)[offset], ALBuf->FmtType,
                         data, type,
                         ChannelsFromFmt(ALBuf->FmtChannels), samples);
+            UpdateEnvelope(ALBuf, start, start+samples);
         }
         WriteUnlock(&ALBuf->lock);
+
+        if(storage)
+            DropOldStorage(Context, storage);
     }
 
     ALCcontext_DecRef(Context);
@@ -609,6 +792,7 @@ AL_API void AL_APIENTRY alGetBufferSamplesSOFT(ALuint buffer,
         ALuint FrameSize;
 
         ReadLock(&ALBuf->lock);
+        WaitForBufferUpload(ALBuf);
         FrameSize = FrameSizeFromFmt(ALBuf->FmtChannels, ALBuf->FmtType);
         if(channels != (ALenum)ALBuf->FmtChannels)
             alSetError(Context, AL_INVALID_ENUM);
@@ -616,10 +800,15 @@ AL_API void AL_APIENTRY alGetBufferSamplesSOFT(ALuint buffer,
             alSetError(Context, AL_INVALID_VALUE);
         else if(type == UserFmtIMA4 && (samples%65) != 0)
             alSetError(Context, AL_INVALID_VALUE);
+        else if(ALBuf->FmtType == FmtIMA4 && (offset%65) != 0)
+            alSetError(Context, AL_INVALID_VALUE);
         else
         {
             /* offset -> byte offset */
-            offset *= FrameSize;
+            if(ALBuf->FmtType == FmtIMA4)
+                offset = offset/65 * 36*ChannelsFromFmt(ALBuf->FmtChannels);
+            else
+                offset *= FrameSize;
             ConvertData(data, type,
                         &((ALubyte*)ALBuf->data)[offset], ALBuf->FmtType,
                         ChannelsFromFmt(ALBuf->FmtChannels), samples);
@@ -951,7 +1140,10 @@ AL_API ALvoid AL_APIENTRY alGetBufferi(ALuint buffer, ALenum eParam, ALint *plVa
             break;
 
         case AL_BITS:
-            *plValue = BytesFromFmt(pBuffer->FmtType) * 8;
+            if(pBuffer->FmtType == FmtIMA4)
+                *plValue = 4;
+            else
+                *plValue = BytesFromFmt(pBuffer->FmtType) * 8;
             break;
 
         case AL_CHANNELS:
@@ -960,8 +1152,12 @@ AL_API ALvoid AL_APIENTRY alGetBufferi(ALuint buffer, ALenum eParam, ALint *plVa
 
         case AL_SIZE:
             ReadLock(&pBuffer->lock);
-            *plValue = pBuffer->SampleLen *
-                       FrameSizeFromFmt(pBuffer->FmtChannels, pBuffer->FmtType);
+            if(pBuffer->FmtType == FmtIMA4)
+                *plValue = pBuffer->SampleLen / 65 * 36 *
+                           ChannelsFromFmt(pBuffer->FmtChannels);
+            else
+                *plValue = pBuffer->SampleLen *
+                           FrameSizeFromFmt(pBuffer->FmtChannels, pBuffer->FmtType);
             ReadUnlock(&pBuffer->lock);
             break;
 
@@ -977,6 +1173,10 @@ AL_API ALvoid AL_APIENTRY alGetBufferi(ALuint buffer, ALenum eParam, ALint *plVa
             *plValue = pBuffer->SampleLen;
             break;
 
+        case AL_BUFFER_READY_SOFTX:
+            *plValue = (pBuffer->UploadPending ? AL_FALSE : AL_TRUE);
+            break;
+
         default:
             alSetError(pContext, AL_INVALID_ENUM);
             break;
@@ -1029,6 +1229,7 @@ AL_API void AL_APIENTRY alGetBufferiv(ALuint buffer, ALenum eParam, ALint* plVal
     case AL_INTERNAL_FORMAT_SOFT:
     case AL_BYTE_LENGTH_SOFT:
     case AL_SAMPLE_LENGTH_SOFT:
+    case AL_BUFFER_READY_SOFTX:
         alGetBufferi(buffer, eParam, plValues);
         return;
     }
@@ -1128,7 +1329,7 @@ static ALalaw EncodeALaw(ALshort val)
     return ((exp<<4) | mant) ^ (sign^0x55);
 }
 
-static void DecodeIMA4Block(ALshort *dst, const ALima4 *src, ALint numchans)
+void DecodeIMA4Block(ALshort *dst, const ALima4 *src, ALint numchans)
 {
     ALint sample[MAXCHANNELS], index[MAXCHANNELS];
     ALuint code[MAXCHANNELS];
@@ -1853,8 +2054,8 @@ DECL_TEMPLATE(ALdouble)
 DECL_TEMPLATE(ALmulaw)
 DECL_TEMPLATE(ALalaw)
 static void Convert_ALima4_ALima4(ALima4 *dst, const ALima4 *src,
-                                  ALuint numchans, ALuint numblocks)
-{ memcpy(dst, src, numblocks*36*numchans); }
+                                  ALuint numchans, ALuint len)
+{ memcpy(dst, src, len/65*36*numchans); }
 DECL_TEMPLATE(ALbyte3)
 DECL_TEMPLATE(ALubyte3)
 
@@ -1971,83 +2172,1278 @@ static void ConvertData(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src
     }
 }
 
+typedef struct ConvertChunk {
+    ALvoid *dst;
+    enum UserFmtType DstType;
+    const ALvoid *src;
+    enum UserFmtType SrcType;
+    ALsizei NumChans;
+    ALsizei Frames;
+} ConvertChunk;
+
+static ALuint ConvertChunkProc(ALvoid *ptr)
+{
+    ConvertChunk *chunk = ptr;
+    ConvertData(chunk->dst, chunk->DstType, chunk->src, chunk->SrcType,
+                chunk->NumChans, chunk->Frames);
+    return 0;
+}
+
+static __inline size_t ChunkOffset(enum UserFmtType type, ALsizei numchans, ALsizei frames)
+{
+    if(type == UserFmtIMA4)
+        return (size_t)(frames/65) * 36 * numchans;
+    return (size_t)frames * numchans * BytesFromUserFmt(type);
+}
 
 /*
- * LoadData
+ * ConvertDataParallel
  *
- * Loads the specified data into the buffer, using the specified formats.
- * Currently, the new format must have the same channel configuration as the
- * original format.
+ * Converts like ConvertData, but splits a large conversion into chunks that
+ * are converted by separate threads, with the calling thread doing the first.
+ * Chunks are made of whole IMA4 blocks so each one starts on a block header.
  */
-static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels SrcChannels, enum UserFmtType SrcType, const ALvoid *data, ALboolean storesrc)
+static void ConvertDataParallel(ALvoid *dst, enum UserFmtType dstType, const ALvoid *src, enum UserFmtType srcType, ALsizei numchans, ALsizei len)
 {
-    ALuint NewChannels, NewBytes;
-    enum FmtChannels DstChannels;
-    enum FmtType DstType;
-    ALuint64 newsize;
-    ALvoid *temp;
-
-    if(DecomposeFormat(NewFormat, &DstChannels, &DstType) == AL_FALSE ||
-       (long)SrcChannels != (long)DstChannels)
-        return AL_INVALID_ENUM;
-
-    NewChannels = ChannelsFromFmt(DstChannels);
-    NewBytes = BytesFromFmt(DstType);
+    ConvertChunk chunks[MAX_CONVERT_THREADS];
+    ALvoid *threads[MAX_CONVERT_THREADS];
+    ALsizei count, step, done, i;
+
+    count = (ConvertThreads < MAX_CONVERT_THREADS) ? ConvertThreads :
+            MAX_CONVERT_THREADS;
+    /* IMA4 encoding carries its state from one block to the next, so it can't
+     * be split */
+    if(count < 2 || (ALuint)len < ConvertThreshold || dstType == UserFmtIMA4)
+    {
+        ConvertData(dst, dstType, src, srcType, numchans, len);
+        return;
+    }
 
-    newsize = frames;
-    newsize *= NewBytes;
-    newsize *= NewChannels;
-    if(newsize > INT_MAX)
-        return AL_OUT_OF_MEMORY;
+    step = (len+count-1) / count;
+    step = (step+64) / 65 * 65;
 
-    WriteLock(&ALBuf->lock);
-    if(ALBuf->ref != 0)
+    done = 0;
+    for(i = 0;i < count && done < len;i++)
     {
-        WriteUnlock(&ALBuf->lock);
-        return AL_INVALID_OPERATION;
+        chunks[i].dst = (ALubyte*)dst + ChunkOffset(dstType, numchans, done);
+        chunks[i].DstType = dstType;
+        chunks[i].src = (const ALubyte*)src + ChunkOffset(srcType, numchans, done);
+        chunks[i].SrcType = srcType;
+        chunks[i].NumChans = numchans;
+        chunks[i].Frames = (len-done < step) ? (len-done) : step;
+        done += chunks[i].Frames;
     }
+    count = i;
 
-    temp = realloc(ALBuf->data, (size_t)newsize);
-    if(!temp && newsize)
+    for(i = 1;i < count;i++)
+        threads[i] = StartThread(ConvertChunkProc, &chunks[i]);
+    ConvertChunkProc(&chunks[0]);
+    for(i = 1;i < count;i++)
     {
-        WriteUnlock(&ALBuf->lock);
-        return AL_OUT_OF_MEMORY;
+        /* Chunks that didn't get a thread are done here */
+        if(threads[i])
+            StopThread(threads[i]);
+        else
+            ConvertChunkProc(&chunks[i]);
     }
-    ALBuf->data = temp;
+}
 
-    if(data != NULL)
-        ConvertData(ALBuf->data, DstType, data, SrcType, NewChannels, frames);
 
-    if(storesrc)
+/*
+ * UploadProc
+ *
+ * Runs queued uploads until the queue is empty.
+ */
+static ALuint UploadProc(ALvoid *ptr)
+{
+    ALbufferUpload *job;
+    (void)ptr;
+
+    while(1)
     {
-        ALBuf->OriginalChannels = SrcChannels;
-        ALBuf->OriginalType     = SrcType;
-        if(SrcType == UserFmtIMA4)
-            ALBuf->OriginalSize = frames / 65 * 36 * ChannelsFromUserFmt(SrcChannels);
-        else
-            ALBuf->OriginalSize = frames * FrameSizeFromUserFmt(SrcChannels, SrcType);
+        WriteLock(&UploadLock);
+        job = UploadQueue;
+        if(!job)
+        {
+            UploadThreadRunning = AL_FALSE;
+            WriteUnlock(&UploadLock);
+            break;
+        }
+        UploadQueue = job->next;
+        WriteUnlock(&UploadLock);
+
+        ConvertDataParallel(job->dst, job->DstType, job->src, job->SrcType,
+                            job->NumChans, job->Frames);
+        MeasureEnvelope(job->buffer);
+        /* The buffer may be freed as soon as this is cleared */
+        ExchangeInt(&job->buffer->UploadPending, AL_FALSE);
+        free(job);
     }
-    else
+
+    return 0;
+}
+
+/*
+ * QueueBufferUpload
+ *
+ * Adds an upload to the queue, starting the upload thread if it isn't
+ * running. If the thread can't be started, the queue is run here instead.
+ */
+static ALvoid QueueBufferUpload(ALbufferUpload *job)
+{
+    ALbufferUpload **list;
+    ALboolean runhere = AL_FALSE;
+
+    WriteLock(&UploadLock);
+    list = &UploadQueue;
+    while(*list)
+        list = &(*list)->next;
+    *list = job;
+
+    if(!UploadThreadRunning)
     {
-        ALBuf->OriginalChannels = DstChannels;
-        ALBuf->OriginalType     = DstType;
-        ALBuf->OriginalSize     = frames * NewBytes * NewChannels;
+        /* A previous thread has emptied the queue and is exiting */
+        if(UploadThread)
+            StopThread(UploadThread);
+        UploadThread = StartThread(UploadProc, NULL);
+        if(UploadThread)
+            UploadThreadRunning = AL_TRUE;
+        else
+            runhere = AL_TRUE;
     }
+    WriteUnlock(&UploadLock);
 
-    ALBuf->Frequency = freq;
-    ALBuf->FmtChannels = DstChannels;
-    ALBuf->FmtType = DstType;
-    ALBuf->Format = NewFormat;
+    if(runhere)
+        UploadProc(NULL);
+}
 
-    ALBuf->SampleLen = frames;
-    ALBuf->LoopStart = 0;
-    ALBuf->LoopEnd = ALBuf->SampleLen;
+ALvoid WaitForBufferUpload(ALbuffer *buffer)
+{
+    while(buffer->UploadPending)
+        Sleep(1);
+}
+
+/*
+ * StopBufferUploads
+ *
+ * INTERNAL: Waits for the upload thread to exit. Called on library shutdown,
+ * after all buffers (and so all pending uploads) are gone.
+ */
+ALvoid StopBufferUploads(void)
+{
+    ALvoid *thread;
+
+    WriteLock(&UploadLock);
+    thread = UploadThread;
+    UploadThread = NULL;
+    WriteUnlock(&UploadLock);
+
+    if(thread)
+        StopThread(thread);
+}
+
+
+/*
+ * LoadUserData
+ *
+ * Loads data given in one of the application formats, picking the format it
+ * is stored in.
+ */
+static ALenum LoadUserData(ALbuffer *ALBuf, enum FmtType StoreType, ALuint freq, ALenum format, const ALvoid *data, ALsizei size, ALboolean async)
+{
+    enum UserFmtChannels SrcChannels;
+    enum UserFmtType SrcType;
+    ALuint FrameSize;
+    ALenum NewFormat;
+
+    if(DecomposeUserFormat(format, &SrcChannels, &SrcType) == AL_FALSE)
+        return AL_INVALID_ENUM;
+
+    switch(SrcType)
+    {
+        case UserFmtByte:
+        case UserFmtUByte:
+        case UserFmtShort:
+        case UserFmtUShort:
+        case UserFmtFloat:
+            FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
+            if((size%FrameSize) != 0)
+                return AL_INVALID_VALUE;
+            return LoadData(ALBuf, freq, format, size/FrameSize,
+                            SrcChannels, SrcType, data, AL_TRUE, async);
+
+        case UserFmtInt:
+        case UserFmtUInt:
+        case UserFmtByte3:
+        case UserFmtUByte3:
+        case UserFmtDouble:
+        case UserFmtMulaw:
+        case UserFmtAlaw:
+            /* Converted to the device's storage type */
+            FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
+            NewFormat = StorageFormat(SrcChannels, StorageType(SrcType, StoreType));
+            if((size%FrameSize) != 0)
+                return AL_INVALID_VALUE;
+            return LoadData(ALBuf, freq, NewFormat, size/FrameSize,
+                            SrcChannels, SrcType, data, AL_TRUE, async);
+
+        case UserFmtIMA4: {
+            /* Here is where things vary:
+             * nVidia and Apple use 64+1 sample frames per block -> block_size=36 bytes per channel
+             * Most PC sound software uses 2040+1 sample frames per block -> block_size=1024 bytes per channel
+             */
+            FrameSize = ChannelsFromUserFmt(SrcChannels) * 36;
+            /* The blocks are stored as-is and decoded by the mixer as it
+             * reads them, rather than expanded to 16-bit here */
+            NewFormat = StorageFormat(SrcChannels, FmtIMA4);
+            if((size%FrameSize) != 0)
+                return AL_INVALID_VALUE;
+            return LoadData(ALBuf, freq, NewFormat, size/FrameSize*65,
+                            SrcChannels, SrcType, data, AL_TRUE, async);
+        }
+    }
+
+    return AL_INVALID_ENUM;
+}
+
+
+/*
+ * LoadData
+ *
+ * Loads the specified data into the buffer, using the specified formats.
+ * Currently, the new format must have the same channel configuration as the
+ * original format. With async, the conversion is left to the upload thread.
+ */
+static ALenum LoadData(ALbuffer *ALBuf, ALuint freq, ALenum NewFormat, ALsizei frames, enum UserFmtChannels SrcChannels, enum UserFmtType SrcType, const ALvoid *data, ALboolean storesrc, ALboolean async)
+{
+    ALbufferUpload *job = NULL;
+    ALuint NewChannels, NewBytes;
+    enum FmtChannels DstChannels;
+    enum FmtType DstType;
+    ALuint64 newsize;
+    ALvoid *temp;
+
+    if(DecomposeFormat(NewFormat, &DstChannels, &DstType) == AL_FALSE ||
+       (long)SrcChannels != (long)DstChannels)
+        return AL_INVALID_ENUM;
+
+    NewChannels = ChannelsFromFmt(DstChannels);
+    NewBytes = BytesFromFmt(DstType);
+
+    if(DstType == FmtIMA4)
+    {
+        /* Only whole blocks can be stored */
+        if((frames%65) != 0)
+            return AL_INVALID_VALUE;
+        newsize  = frames / 65;
+        newsize *= 36;
+    }
+    else
+    {
+        newsize  = frames;
+        newsize *= NewBytes;
+    }
+    newsize *= NewChannels;
+    if(newsize > INT_MAX)
+        return AL_OUT_OF_MEMORY;
+
+    WriteLock(&ALBuf->lock);
+    if(ALBuf->ref != 0)
+    {
+        WriteUnlock(&ALBuf->lock);
+        return AL_INVALID_OPERATION;
+    }
+    WaitForBufferUpload(ALBuf);
+
+    /* Application memory, file mappings, and storage other buffers still
+     * share are not resized; the buffer gets its own storage again */
+    if(ALBuf->Storage)
+        ClaimStorage(ALBuf);
+    temp = realloc((ALBuf->StaticData || ALBuf->Storage) ? NULL : ALBuf->data,
+                   (size_t)newsize);
+    if(!temp && newsize)
+    {
+        WriteUnlock(&ALBuf->lock);
+        return AL_OUT_OF_MEMORY;
+    }
+    if(ALBuf->Storage)
+        ReleaseStorage(ALBuf->Storage);
+    ALBuf->Storage = NULL;
+    if(ALBuf->Mapping)
+        UnmapFileMem(ALBuf->Mapping, ALBuf->MappingSize);
+    ALBuf->Mapping = NULL;
+    ALBuf->MappingSize = 0;
+    ALBuf->data = temp;
+    ALBuf->StaticData = AL_FALSE;
+
+    if(data != NULL)
+    {
+        if(async && (job=malloc(sizeof(*job))) != NULL)
+        {
+            job->buffer = ALBuf;
+            job->dst = ALBuf->data;
+            job->DstType = (enum UserFmtType)DstType;
+            job->src = data;
+            job->SrcType = SrcType;
+            job->NumChans = NewChannels;
+            job->Frames = frames;
+            job->next = NULL;
+
+            ALBuf->UploadPending = AL_TRUE;
+        }
+        else
+        {
+            ConvertDataParallel(ALBuf->data, DstType, data, SrcType,
+                                NewChannels, frames);
+            if(ShareBufferData && newsize > 0)
+                ShareStorage(ALBuf, (size_t)newsize);
+        }
+    }
+
+    if(storesrc)
+    {
+        ALBuf->OriginalChannels = SrcChannels;
+        ALBuf->OriginalType     = SrcType;
+        if(SrcType == UserFmtIMA4)
+            ALBuf->OriginalSize = frames / 65 * 36 * ChannelsFromUserFmt(SrcChannels);
+        else
+            ALBuf->OriginalSize = frames * FrameSizeFromUserFmt(SrcChannels, SrcType);
+    }
+    else
+    {
+        ALBuf->OriginalChannels = DstChannels;
+        ALBuf->OriginalType     = DstType;
+        ALBuf->OriginalSize     = (ALsizei)newsize;
+    }
+
+    ALBuf->Frequency = freq;
+    ALBuf->FmtChannels = DstChannels;
+    ALBuf->FmtType = DstType;
+    ALBuf->Format = NewFormat;
+
+    ALBuf->SampleLen = frames;
+    ALBuf->LoopStart = 0;
+    ALBuf->LoopEnd = ALBuf->SampleLen;
+
+    /* The envelope is measured once the samples are in, by the upload thread
+     * for an async load */
+    free(ALBuf->Envelope);
+    ALBuf->Envelope = NULL;
+    FreeResampled(ALBuf);
+    if(job)
+        QueueBufferUpload(job);
+    else if(data != NULL)
+        MeasureEnvelope(ALBuf);
+
+    WriteUnlock(&ALBuf->lock);
+    return AL_NO_ERROR;
+}
+
+
+/*
+ * LoadStaticData
+ *
+ * Makes the buffer use the given memory for its samples as they are. The
+ * format must be one the mixer reads directly. A non-NULL mapping is the file
+ * mapping holding the data, which the buffer takes over on success.
+ */
+static ALenum LoadStaticData(ALbuffer *ALBuf, ALuint freq, ALenum format, ALvoid *data, ALsizei size, ALvoid *mapping, size_t mapsize)
+{
+    enum UserFmtChannels SrcChannels;
+    enum UserFmtType SrcType;
+    enum FmtChannels DstChannels;
+    enum FmtType DstType;
+    ALuint FrameSize;
+    ALuint Align;
+
+    if(DecomposeUserFormat(format, &SrcChannels, &SrcType) == AL_FALSE ||
+       DecomposeFormat(format, &DstChannels, &DstType) == AL_FALSE ||
+       (long)SrcType != (long)DstType)
+        return AL_INVALID_ENUM;
+
+    if(DstType == FmtIMA4)
+    {
+        FrameSize = ChannelsFromFmt(DstChannels) * 36;
+        Align = 1;
+    }
+    else
+    {
+        FrameSize = FrameSizeFromFmt(DstChannels, DstType);
+        Align = BytesFromFmt(DstType);
+    }
+    if((size%FrameSize) != 0 || ((size_t)data%Align) != 0)
+        return AL_INVALID_VALUE;
+
+    WriteLock(&ALBuf->lock);
+    if(ALBuf->ref != 0)
+    {
+        WriteUnlock(&ALBuf->lock);
+        return AL_INVALID_OPERATION;
+    }
+    WaitForBufferUpload(ALBuf);
+
+    FreeBufferData(ALBuf);
+    ALBuf->data = data;
+    ALBuf->StaticData = AL_TRUE;
+    ALBuf->Mapping = mapping;
+    ALBuf->MappingSize = mapsize;
+
+    ALBuf->OriginalChannels = SrcChannels;
+    ALBuf->OriginalType     = SrcType;
+    ALBuf->OriginalSize     = size;
+
+    ALBuf->Frequency = freq;
+    ALBuf->FmtChannels = DstChannels;
+    ALBuf->FmtType = DstType;
+    ALBuf->Format = format;
+
+    ALBuf->SampleLen = size / FrameSize;
+    if(DstType == FmtIMA4)
+        ALBuf->SampleLen *= 65;
+    ALBuf->LoopStart = 0;
+    ALBuf->LoopEnd = ALBuf->SampleLen;
+
+    /* No envelope is kept. Application memory can change at any time, and
+     * measuring a file mapping would page in the whole file */
 
     WriteUnlock(&ALBuf->lock);
     return AL_NO_ERROR;
 }
 
 
+static __inline ALuint ReadLE16(const ALubyte *ptr)
+{ return ptr[0] | (ptr[1]<<8); }
+
+static __inline ALuint ReadLE32(const ALubyte *ptr)
+{ return ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | ((ALuint)ptr[3]<<24); }
+
+/*
+ * ParseWave
+ *
+ * Finds the sample format and the sample data of a RIFF WAVE file held in
+ * memory.
+ */
+static ALenum ParseWave(const ALubyte *file, size_t filesize, enum UserFmtChannels *chans, enum UserFmtType *type, ALuint *freq, size_t *dataoffset, size_t *datasize)
+{
+    const ALubyte *fmt = NULL;
+    const ALubyte *data = NULL;
+    ALuint fmttag, channels, blockalign, bits;
+    size_t chunksize, fmtsize = 0;
+    size_t pos;
+
+    if(filesize < 12 || memcmp(file, "RIFF", 4) != 0 ||
+       memcmp(file+8, "WAVE", 4) != 0)
+        return AL_INVALID_VALUE;
+
+    pos = 12;
+    while(filesize-pos >= 8)
+    {
+        const ALubyte *chunk = file+pos;
+
+        /* Files written while streaming may not have the real size of the
+         * last chunk, so clamp sizes to what's there */
+        chunksize = ReadLE32(chunk+4);
+        pos += 8;
+        if(chunksize > filesize-pos)
+            chunksize = filesize-pos;
+
+        if(memcmp(chunk, "fmt ", 4) == 0 && chunksize >= 16)
+        {
+            fmt = chunk+8;
+            fmtsize = chunksize;
+        }
+        else if(memcmp(chunk, "data", 4) == 0 && fmt != NULL)
+        {
+            data = chunk+8;
+            break;
+        }
+
+        /* Chunks are padded to an even size */
+        pos += chunksize;
+        if((chunksize&1) && pos < filesize)
+            pos++;
+    }
+    if(data == NULL)
+        return AL_INVALID_VALUE;
+
+    fmttag     = ReadLE16(fmt);
+    channels   = ReadLE16(fmt+2);
+    *freq      = ReadLE32(fmt+4);
+    blockalign = ReadLE16(fmt+12);
+    bits       = ReadLE16(fmt+14);
+    /* WAVE_FORMAT_EXTENSIBLE keeps the real format tag at the start of its
+     * sub-format GUID */
+    if(fmttag == 0xFFFE && fmtsize >= 40)
+        fmttag = ReadLE16(fmt+24);
+
+    switch(channels)
+    {
+        case 1: *chans = UserFmtMono; break;
+        case 2: *chans = UserFmtStereo; break;
+        case 4: *chans = UserFmtQuad; break;
+        case 6: *chans = UserFmtX51; break;
+        case 7: *chans = UserFmtX61; break;
+        case 8: *chans = UserFmtX71; break;
+        default: return AL_INVALID_ENUM;
+    }
+
+    if(fmttag == 0x0001 && bits == 8)
+        *type = UserFmtUByte;
+    else if(fmttag == 0x0001 && bits == 16)
+        *type = UserFmtShort;
+    else if(fmttag == 0x0001 && bits == 24)
+        *type = UserFmtByte3;
+    else if(fmttag == 0x0001 && bits == 32)
+        *type = UserFmtInt;
+    else if(fmttag == 0x0003 && bits == 32)
+        *type = UserFmtFloat;
+    else if(fmttag == 0x0003 && bits == 64)
+        *type = UserFmtDouble;
+    else if(fmttag == 0x0006 && bits == 8)
+        *type = UserFmtAlaw;
+    else if(fmttag == 0x0007 && bits == 8)
+        *type = UserFmtMulaw;
+    else if(fmttag == 0x0011)
+    {
+        /* Only blocks of 65 frames can be decoded */
+        if(blockalign != 36*channels)
+            return AL_INVALID_ENUM;
+        *type = UserFmtIMA4;
+    }
+    else
+        return AL_INVALID_ENUM;
+
+    if(*type != UserFmtIMA4 && blockalign != FrameSizeFromUserFmt(*chans, *type))
+        return AL_INVALID_ENUM;
+    if(*freq == 0)
+        return AL_INVALID_VALUE;
+
+    *dataoffset = data-file;
+    *datasize = chunksize;
+    return AL_NO_ERROR;
+}
+
+/*
+ * StorageType
+ *
+ * Returns the sample type data of the given type is kept as. Types the mixer
+ * reads directly are kept as-is, and others are converted to the device's
+ * storage type, though companded samples never need more than 16 bits.
+ */
+static enum FmtType StorageType(enum UserFmtType SrcType, enum FmtType StoreType)
+{
+    switch(SrcType)
+    {
+        case UserFmtByte:
+        case UserFmtUByte:
+            return FmtByte;
+        case UserFmtShort:
+        case UserFmtUShort:
+            return FmtShort;
+        case UserFmtFloat:
+            return FmtFloat;
+        case UserFmtMulaw:
+        case UserFmtAlaw:
+            return (StoreType == FmtByte) ? FmtByte : FmtShort;
+        case UserFmtInt:
+        case UserFmtUInt:
+        case UserFmtDouble:
+        case UserFmtByte3:
+        case UserFmtUByte3:
+            return StoreType;
+        case UserFmtIMA4:
+            return FmtIMA4;
+    }
+    return FmtFloat;
+}
+
+/*
+ * StorageFormat
+ *
+ * Returns the internal format for the given channels and storage type, or
+ * AL_NONE if there is none.
+ */
+static ALenum StorageFormat(enum UserFmtChannels chans, enum FmtType type)
+{
+    static const struct {
+        enum UserFmtChannels channels;
+        ALenum byteFormat;
+        ALenum shortFormat;
+        ALenum floatFormat;
+        ALenum ima4Format;
+    } list[] = {
+        { UserFmtMono,   AL_MONO8_SOFT,     AL_MONO16_SOFT,     AL_MONO32F_SOFT,     AL_FORMAT_MONO_IMA4   },
+        { UserFmtStereo, AL_STEREO8_SOFT,   AL_STEREO16_SOFT,   AL_STEREO32F_SOFT,   AL_FORMAT_STEREO_IMA4 },
+        { UserFmtRear,   AL_REAR8_SOFT,     AL_REAR16_SOFT,     AL_REAR32F_SOFT,     AL_NONE },
+        { UserFmtQuad,   AL_QUAD8_SOFT,     AL_QUAD16_SOFT,     AL_QUAD32F_SOFT,     AL_NONE },
+        { UserFmtX51,    AL_5POINT1_8_SOFT, AL_5POINT1_16_SOFT, AL_5POINT1_32F_SOFT, AL_NONE },
+        { UserFmtX61,    AL_6POINT1_8_SOFT, AL_6POINT1_16_SOFT, AL_6POINT1_32F_SOFT, AL_NONE },
+        { UserFmtX71,    AL_7POINT1_8_SOFT, AL_7POINT1_16_SOFT, AL_7POINT1_32F_SOFT, AL_NONE },
+    };
+    ALuint i;
+
+    for(i = 0;i < COUNTOF(list);i++)
+    {
+        if(list[i].channels != chans)
+            continue;
+        switch(type)
+        {
+            case FmtByte: return list[i].byteFormat;
+            case FmtShort: return list[i].shortFormat;
+            case FmtFloat: return list[i].floatFormat;
+            case FmtIMA4: return list[i].ima4Format;
+        }
+    }
+    return AL_NONE;
+}
+
+/*
+ * LoadFile
+ *
+ * Loads the samples of a mapped sound file (see alBufferFileSOFT). Samples in
+ * a format the mixer reads directly are used from the mapping, which the
+ * buffer then keeps. Anything else is converted like alBufferData does, and
+ * the mapping released.
+ */
+static ALenum LoadFile(ALbuffer *ALBuf, enum FmtType StoreType, ALubyte *mapping, size_t mapsize, ALenum format, ALsizei freq)
+{
+    enum UserFmtChannels SrcChannels;
+    enum UserFmtType SrcType;
+    enum FmtType DstType;
+    ALenum NewFormat;
+    ALuint FrameSize;
+    size_t offset, size;
+    ALuint rate;
+    ALenum err;
+
+    if(format == AL_NONE)
+        err = ParseWave(mapping, mapsize, &SrcChannels, &SrcType, &rate, &offset, &size);
+    else if(DecomposeUserFormat(format, &SrcChannels, &SrcType) == AL_FALSE)
+        err = AL_INVALID_ENUM;
+    else
+    {
+        rate = freq;
+        offset = 0;
+        size = mapsize;
+        err = AL_NO_ERROR;
+    }
+    if(err == AL_NO_ERROR && size > INT_MAX)
+        err = AL_OUT_OF_MEMORY;
+    if(err != AL_NO_ERROR)
+        goto error;
+
+    DstType = StorageType(SrcType, StoreType);
+    NewFormat = StorageFormat(SrcChannels, DstType);
+    if(NewFormat == AL_NONE)
+    {
+        /* Only mono and stereo IMA4 can stay compressed */
+        DstType = FmtShort;
+        NewFormat = StorageFormat(SrcChannels, DstType);
+    }
+
+    /* Drop any trailing partial frame */
+    if(SrcType == UserFmtIMA4)
+        FrameSize = ChannelsFromUserFmt(SrcChannels) * 36;
+    else
+        FrameSize = FrameSizeFromUserFmt(SrcChannels, SrcType);
+    size -= size%FrameSize;
+
+    if((long)SrcType == (long)DstType &&
+       (SrcType == UserFmtIMA4 || (offset%BytesFromUserFmt(SrcType)) == 0))
+    {
+        err = LoadStaticData(ALBuf, rate, NewFormat, mapping+offset,
+                             (ALsizei)size, mapping, mapsize);
+        if(err != AL_NO_ERROR)
+            goto error;
+        return AL_NO_ERROR;
+    }
+
+    size /= FrameSize;
+    if(SrcType == UserFmtIMA4)
+        size *= 65;
+    err = LoadData(ALBuf, rate, NewFormat, (ALsizei)size, SrcChannels, SrcType,
+                   mapping+offset, AL_TRUE, AL_FALSE);
+
+error:
+    UnmapFileMem(mapping, mapsize);
+    return err;
+}
+
+static ALuint HashData(const ALubyte *data, size_t size)
+{
+    /* 32-bit FNV-1a */
+    ALuint hash = 2166136261u;
+    size_t i;
+
+    for(i = 0;i < size;i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void UnlinkStorage(ALbufferStorage *storage)
+{
+    ALbufferStorage **list = &StorageTable[storage->hash%STORAGE_TABLE_SIZE];
+    if(!storage->Hashed)
+        return;
+    while(*list != storage)
+        list = &(*list)->next;
+    *list = storage->next;
+}
+
+/*
+ * ShareStorage
+ *
+ * Makes the buffer share the storage of a buffer already holding the same
+ * samples, freeing its own copy. If there is none, its data is added to the
+ * table for later buffers to find.
+ */
+static void ShareStorage(ALbuffer *ALBuf, size_t size)
+{
+    ALbufferStorage *storage;
+    ALuint hash;
+
+    hash = HashData(ALBuf->data, size);
+
+    WriteLock(&StorageLock);
+    storage = StorageTable[hash%STORAGE_TABLE_SIZE];
+    while(storage)
+    {
+        if(storage->hash == hash && storage->size == size &&
+           memcmp(storage->data, ALBuf->data, size) == 0)
+            break;
+        storage = storage->next;
+    }
+
+    if(storage)
+    {
+        storage->ref++;
+        free(ALBuf->data);
+        ALBuf->data = storage->data;
+        ALBuf->Storage = storage;
+    }
+    else if((storage=malloc(sizeof(ALbufferStorage))) != NULL)
+    {
+        storage->data = ALBuf->data;
+        storage->size = size;
+        storage->Mapping = NULL;
+        storage->MappingSize = 0;
+        storage->Hashed = AL_TRUE;
+        storage->hash = hash;
+        storage->ref = 1;
+        storage->next = StorageTable[hash%STORAGE_TABLE_SIZE];
+        StorageTable[hash%STORAGE_TABLE_SIZE] = storage;
+        ALBuf->Storage = storage;
+    }
+    WriteUnlock(&StorageLock);
+}
+
+/*
+ * ReleaseStorage
+ *
+ * Drops a reference to shared storage, freeing it once nothing uses it.
+ */
+static void ReleaseStorage(ALbufferStorage *storage)
+{
+    ALuint ref;
+
+    WriteLock(&StorageLock);
+    ref = --storage->ref;
+    if(ref == 0)
+        UnlinkStorage(storage);
+    WriteUnlock(&StorageLock);
+
+    if(ref == 0)
+    {
+        if(storage->Mapping)
+            UnmapFileMem(storage->Mapping, storage->MappingSize);
+        else
+            free(storage->data);
+        free(storage);
+    }
+}
+
+/*
+ * ClaimStorage
+ *
+ * If no other buffer uses the buffer's storage, takes it out of the table so
+ * its data becomes a plain allocation the buffer owns. Mapped storage is never
+ * claimed, so it's copied before being written to.
+ */
+static ALboolean ClaimStorage(ALbuffer *ALBuf)
+{
+    ALbufferStorage *storage = ALBuf->Storage;
+    ALboolean claimed = AL_FALSE;
+
+    WriteLock(&StorageLock);
+    if(storage->ref == 1 && !storage->Mapping)
+    {
+        UnlinkStorage(storage);
+        claimed = AL_TRUE;
+    }
+    WriteUnlock(&StorageLock);
+
+    if(claimed)
+    {
+        ALBuf->Storage = NULL;
+        free(storage);
+    }
+    return claimed;
+}
+
+/*
+ * BufferDataSize
+ *
+ * Returns the size in bytes of the samples the buffer holds.
+ */
+static size_t BufferDataSize(const ALbuffer *ALBuf)
+{
+    if(ALBuf->FmtType == FmtIMA4)
+        return (size_t)(ALBuf->SampleLen/65) * 36 *
+               ChannelsFromFmt(ALBuf->FmtChannels);
+    return (size_t)ALBuf->SampleLen *
+           FrameSizeFromFmt(ALBuf->FmtChannels, ALBuf->FmtType);
+}
+
+/*
+ * RegisterStorage
+ *
+ * Turns the buffer's own data, or its file mapping, into shared storage
+ * without moving it, so the buffer can keep playing while other buffers take
+ * references.
+ */
+static ALboolean RegisterStorage(ALbuffer *ALBuf)
+{
+    ALbufferStorage *storage;
+    size_t size = BufferDataSize(ALBuf);
+
+    storage = malloc(sizeof(ALbufferStorage));
+    if(!storage)
+        return AL_FALSE;
+    storage->data = ALBuf->data;
+    storage->size = size;
+    storage->Mapping = ALBuf->Mapping;
+    storage->MappingSize = ALBuf->MappingSize;
+    storage->Hashed = (ALBuf->Mapping ? AL_FALSE : AL_TRUE);
+    storage->hash = (storage->Hashed ? HashData(ALBuf->data, size) : 0);
+    storage->ref = 1;
+
+    WriteLock(&StorageLock);
+    if(storage->Hashed)
+    {
+        storage->next = StorageTable[storage->hash%STORAGE_TABLE_SIZE];
+        StorageTable[storage->hash%STORAGE_TABLE_SIZE] = storage;
+    }
+    else
+        storage->next = NULL;
+    WriteUnlock(&StorageLock);
+
+    ALBuf->Storage = storage;
+    ALBuf->StaticData = AL_FALSE;
+    ALBuf->Mapping = NULL;
+    ALBuf->MappingSize = 0;
+    return AL_TRUE;
+}
+
+/*
+ * MakeBufferDataUnique
+ *
+ * Gets the buffer a copy of its data that's safe to write to, if it's shared
+ * with other buffers. Called with the buffer locked for writing. The mixer may
+ * still be reading the old storage, so it's returned in 'old' for the caller
+ * to hand to DropOldStorage once the buffer is unlocked.
+ */
+static ALboolean MakeBufferDataUnique(ALbuffer *ALBuf, ALbufferStorage **old)
+{
+    ALbufferStorage *storage = ALBuf->Storage;
+    ALvoid *temp;
+
+    *old = NULL;
+    if(!storage || ClaimStorage(ALBuf))
+        return AL_TRUE;
+
+    temp = malloc(storage->size);
+    if(!temp)
+        return AL_FALSE;
+    memcpy(temp, storage->data, storage->size);
+
+    ExchangePtr((XchgPtr*)&ALBuf->data, temp);
+    ALBuf->Storage = NULL;
+    *old = storage;
+    return AL_TRUE;
+}
+
+/*
+ * DropOldStorage
+ *
+ * Releases storage swapped out by MakeBufferDataUnique. Locking the device
+ * first waits out any mix that started with the old pointer, so the storage
+ * can't be freed under it.
+ */
+static void DropOldStorage(ALCcontext *context, ALbufferStorage *storage)
+{
+    LockContext(context);
+    UnlockContext(context);
+    ReleaseStorage(storage);
+}
+
+
+/*
+ * ImportBuffer
+ *
+ * Makes the buffer use the samples of another buffer, which may be on another
+ * device, taking a reference to its storage instead of copying it. Data the
+ * application gave with alBufferDataStatic has no reference to take, and the
+ * application may free it once the source buffer is deleted or reloaded, so
+ * the buffer gets its own copy of that instead.
+ */
+ALenum ImportBuffer(ALbuffer *ALBuf, ALbuffer *src)
+{
+    ALbufferStorage *storage;
+    ALushort (*envelope)[2] = NULL;
+    ALvoid *data, *copy = NULL;
+    ALbuffer fmt;
+
+    if(ALBuf == src)
+        return AL_NO_ERROR;
+
+    WriteLock(&src->lock);
+    WaitForBufferUpload(src);
+    if(src->data && !src->Storage && (!src->StaticData || src->Mapping))
+    {
+        if(!RegisterStorage(src))
+        {
+            WriteUnlock(&src->lock);
+            return AL_OUT_OF_MEMORY;
+        }
+    }
+    else if(src->data && src->StaticData && !src->Mapping)
+    {
+        size_t size = BufferDataSize(src);
+        if((copy=malloc(size)) == NULL)
+        {
+            WriteUnlock(&src->lock);
+            return AL_OUT_OF_MEMORY;
+        }
+        memcpy(copy, src->data, size);
+    }
+    storage = src->Storage;
+    if(storage)
+    {
+        WriteLock(&StorageLock);
+        storage->ref++;
+        WriteUnlock(&StorageLock);
+    }
+    if(src->Envelope)
+    {
+        size_t size = (src->SampleLen+ENVELOPE_BLOCK_SIZE-1) /
+                      ENVELOPE_BLOCK_SIZE * sizeof(*envelope);
+        if((envelope=malloc(size)) != NULL)
+            memcpy(envelope, src->Envelope, size);
+    }
+    data = (copy ? copy : src->data);
+    fmt = *src;
+    WriteUnlock(&src->lock);
+
+    WriteLock(&ALBuf->lock);
+    if(ALBuf->ref != 0)
+    {
+        WriteUnlock(&ALBuf->lock);
+        if(storage)
+            ReleaseStorage(storage);
+        free(copy);
+        free(envelope);
+        return AL_INVALID_OPERATION;
+    }
+    WaitForBufferUpload(ALBuf);
+
+    FreeBufferData(ALBuf);
+    ALBuf->data = data;
+    ALBuf->StaticData = AL_FALSE;
+    ALBuf->Storage = storage;
+
+    ALBuf->OriginalChannels = fmt.OriginalChannels;
+    ALBuf->OriginalType     = fmt.OriginalType;
+    ALBuf->OriginalSize     = fmt.OriginalSize;
+
+    ALBuf->Frequency = fmt.Frequency;
+    ALBuf->FmtChannels = fmt.FmtChannels;
+    ALBuf->FmtType = fmt.FmtType;
+    ALBuf->Format = fmt.Format;
+
+    ALBuf->SampleLen = fmt.SampleLen;
+    ALBuf->LoopStart = fmt.LoopStart;
+    ALBuf->LoopEnd = fmt.LoopEnd;
+    ALBuf->Envelope = envelope;
+
+    WriteUnlock(&ALBuf->lock);
+    return AL_NO_ERROR;
+}
+
+
+/*
+ * MeasureEnvelope
+ *
+ * Allocates and fills in the buffer's level envelope. Without the memory for
+ * it, the buffer just goes without.
+ */
+static void MeasureEnvelope(ALbuffer *ALBuf)
+{
+    ALsizei blocks = (ALBuf->SampleLen+ENVELOPE_BLOCK_SIZE-1) / ENVELOPE_BLOCK_SIZE;
+
+    free(ALBuf->Envelope);
+    ALBuf->Envelope = NULL;
+    if(blocks == 0 || !ALBuf->data)
+        return;
+
+    ALBuf->Envelope = malloc(blocks * sizeof(*ALBuf->Envelope));
+    UpdateEnvelope(ALBuf, 0, ALBuf->SampleLen);
+}
+
+static __inline ALushort EnvelopeLevel(ALfloat level)
+{
+    if(level >= 1.0f)
+        return 65535;
+    return (ALushort)ceil(level * 65535.0f);
+}
+
+/*
+ * UpdateEnvelope
+ *
+ * Measures the envelope blocks covering the given sample frames.
+ */
+static void UpdateEnvelope(ALbuffer *ALBuf, ALsizei start, ALsizei end)
+{
+    const ALuint NumChans = ChannelsFromFmt(ALBuf->FmtChannels);
+    /* Decoded four IMA4 blocks at a time, so each chunk starts on one */
+    ALfloat samples[65*4 * MAXCHANNELS];
+    const ALsizei ChunkLen = 65*4;
+    ALfloat peak = 0.0f, sum = 0.0f;
+    ALsizei count = 0;
+    ALsizei pos, todo, i;
+    ALuint c;
+
+    if(!ALBuf->Envelope)
+        return;
+
+    start -= start%ENVELOPE_BLOCK_SIZE;
+    end = (end+ENVELOPE_BLOCK_SIZE-1) / ENVELOPE_BLOCK_SIZE * ENVELOPE_BLOCK_SIZE;
+    if(end > ALBuf->SampleLen)
+        end = ALBuf->SampleLen;
+
+    pos = start;
+    if(ALBuf->FmtType == FmtIMA4)
+        pos -= pos%65;
+    while(pos < end)
+    {
+        const ALubyte *src = ALBuf->data;
+        if(ALBuf->FmtType == FmtIMA4)
+            src += (size_t)(pos/65) * 36 * NumChans;
+        else
+            src += (size_t)pos * FrameSizeFromFmt(ALBuf->FmtChannels, ALBuf->FmtType);
+
+        todo = (end-pos < ChunkLen) ? (end-pos) : ChunkLen;
+        ConvertData(samples, UserFmtFloat, src, (enum UserFmtType)ALBuf->FmtType,
+                    NumChans, todo);
+
+        for(i = 0;i < todo;i++,pos++)
+        {
+            if(pos < start)
+                continue;
+
+            for(c = 0;c < NumChans;c++)
+            {
+                ALfloat val = fabs(samples[i*NumChans + c]);
+                if(val > peak) peak = val;
+                sum += val*val;
+            }
+            count++;
+
+            if(((pos+1)%ENVELOPE_BLOCK_SIZE) == 0 || pos+1 == end)
+            {
+                ALushort *level = ALBuf->Envelope[pos/ENVELOPE_BLOCK_SIZE];
+                level[0] = EnvelopeLevel(peak);
+                level[1] = EnvelopeLevel((ALfloat)sqrt(sum / (count*NumChans)));
+                peak = sum = 0.0f;
+                count = 0;
+            }
+        }
+    }
+}
+
+/*
+ * MarkEnvelope
+ *
+ * Sets the envelope blocks covering the given sample frames to full level,
+ * so the mixer won't skip them while they're being written.
+ */
+static void MarkEnvelope(ALbuffer *ALBuf, ALsizei start, ALsizei end)
+{
+    ALsizei i;
+
+    if(!ALBuf->Envelope)
+        return;
+
+    for(i = start/ENVELOPE_BLOCK_SIZE;i*ENVELOPE_BLOCK_SIZE < end;i++)
+    {
+        ALBuf->Envelope[i][0] = 65535;
+        ALBuf->Envelope[i][1] = 65535;
+    }
+}
+
+
+/*
+ * PrepareResampledBuffer
+ *
+ * Makes the buffer's resampled copy for the given device rate, if it doesn't
+ * have one. The copy is only made or replaced while no source uses the
+ * buffer, since the mixer reads it without locking. A source taking the
+ * buffer locks it after adding its reference, so it waits for a copy being
+ * made here to be finished.
+ */
+ALvoid PrepareResampledBuffer(ALbuffer *ALBuf, ALuint DeviceFreq)
+{
+    const ALuint NumChans = ChannelsFromFmt(ALBuf->FmtChannels);
+    ALbufferCache *cache = NULL;
+    ALfloat *samples = NULL;
+    ALfloat *kernel = NULL;
+    ALfloat *weights;
+    ALfloat cutoff, pitch;
+    ALint width, step;
+    ALsizei i, j;
+    ALuint k;
+
+    if(!ALBuf || BufferResampleCache == ResampleCacheNone)
+        return;
+
+    WriteLock(&ALBuf->lock);
+    /* Application memory may change without the buffer knowing */
+    if(!ALBuf->data || ALBuf->UploadPending ||
+       (ALBuf->StaticData && !ALBuf->Mapping))
+        goto done;
+
+    /* Same as the step a source at pitch 1 gets */
+    pitch = 1.0f * ALBuf->Frequency / DeviceFreq;
+    step = fastf2i(pitch*FRACTIONONE);
+    if(step <= 0 || step == FRACTIONONE)
+        goto done;
+    if(ALBuf->ref != 0 ||
+       (ALBuf->Resampled && ALBuf->Resampled->Step == (ALuint)step))
+        goto done;
+    FreeResampled(ALBuf);
+
+    /* Windowed sinc, with the cutoff lowered along with the rate */
+    cutoff = (step > FRACTIONONE) ? (ALfloat)FRACTIONONE/step : 1.0f;
+    width = (ALint)ceil(RESAMPLE_HALF_TAPS / cutoff);
+    kernel = malloc((width*RESAMPLE_PHASES + 2 + width*2) * sizeof(ALfloat));
+    samples = malloc((size_t)ALBuf->SampleLen * NumChans * sizeof(ALfloat));
+    cache = malloc(sizeof(*cache) + ((((ALuint64)ALBuf->SampleLen<<FRACTIONBITS) +
+                                      step-1) / step) * NumChans * sizeof(ALfloat));
+    if(!kernel || !samples || !cache)
+        goto done;
+    weights = &kernel[width*RESAMPLE_PHASES + 2];
+
+    for(i = 0;i < width*RESAMPLE_PHASES + 2;i++)
+    {
+        ALdouble x = (ALdouble)i / RESAMPLE_PHASES;
+        ALdouble u = x / width;
+        ALdouble sinc = 1.0, window = 0.0;
+
+        if(x > 0.0)
+            sinc = sin(F_PI*cutoff*x) / (F_PI*cutoff*x);
+        if(u < 1.0)
+            window = 0.42 + 0.5*cos(F_PI*u) + 0.08*cos(2.0*F_PI*u);
+        kernel[i] = (ALfloat)(cutoff * sinc * window);
+    }
+
+    ConvertData(samples, UserFmtFloat, ALBuf->data, (enum UserFmtType)ALBuf->FmtType,
+                NumChans, ALBuf->SampleLen);
+
+    cache->Step = step;
+    cache->SampleLen = (ALsizei)((((ALuint64)ALBuf->SampleLen<<FRACTIONBITS) +
+                                  step-1) / step);
+    cache->data = (ALfloat*)(cache+1);
+    for(j = 0;j < cache->SampleLen;j++)
+    {
+        ALuint64 pos = (ALuint64)j * step;
+        ALint ipos = (ALint)(pos>>FRACTIONBITS);
+        ALfloat frac = (pos&FRACTIONMASK) * (1.0f/FRACTIONONE);
+        ALfloat total = 0.0f;
+        ALint first = maxi(ipos-width+1, 0);
+        ALint last = mini(ipos+width, ALBuf->SampleLen-1);
+        ALint t;
+
+        for(t = first;t <= last;t++)
+        {
+            ALfloat x = fabs(t - ipos - frac) * RESAMPLE_PHASES;
+            ALint idx = (ALint)x;
+            ALfloat w = 0.0f;
+            if(idx < width*RESAMPLE_PHASES)
+                w = kernel[idx] + (kernel[idx+1]-kernel[idx])*(x-idx);
+            weights[t-first] = w;
+            total += w;
+        }
+        /* Keep the DC gain at unity, except where the filter runs off the
+         * ends of the data */
+        if(first > ipos-width+1 || last < ipos+width || total == 0.0f)
+            total = 1.0f;
+
+        for(k = 0;k < NumChans;k++)
+        {
+            ALfloat val = 0.0f;
+            for(t = first;t <= last;t++)
+                val += samples[t*NumChans + k] * weights[t-first];
+            cache->data[j*NumChans + k] = val / total;
+        }
+    }
+
+    ExchangePtr((XchgPtr*)&ALBuf->Resampled, cache);
+    cache = NULL;
+
+done:
+    WriteUnlock(&ALBuf->lock);
+    free(cache);
+    free(samples);
+    free(kernel);
+}
+
+/*
+ * FreeResampled
+ *
+ * Frees the buffer's resampled copy. The buffer must not be in use.
+ */
+static void FreeResampled(ALbuffer *ALBuf)
+{
+    free(ALBuf->Resampled);
+    ALBuf->Resampled = NULL;
+}
+
+/*
+ * FreeBufferData
+ *
+ * Releases the buffer's sample storage, unless it belongs to the application.
+ */
+static void FreeBufferData(ALbuffer *ALBuf)
+{
+    if(ALBuf->Storage)
+        ReleaseStorage(ALBuf->Storage);
+    else if(ALBuf->Mapping)
+        UnmapFileMem(ALBuf->Mapping, ALBuf->MappingSize);
+    else if(!ALBuf->StaticData)
+        free(ALBuf->data);
+    ALBuf->data = NULL;
+    ALBuf->StaticData = AL_FALSE;
+    ALBuf->Mapping = NULL;
+    ALBuf->MappingSize = 0;
+    ALBuf->Storage = NULL;
+    free(ALBuf->Envelope);
+    ALBuf->Envelope = NULL;
+    FreeResampled(ALBuf);
+}
+
+
 ALuint BytesFromUserFmt(enum UserFmtType type)
 {
     switch(type)
@@ -2156,6 +3552,7 @@ ALuint BytesFromFmt(enum FmtType type)
     case FmtByte: return sizeof(ALbyte);
     case FmtShort: return sizeof(ALshort);
     case FmtFloat: return sizeof(ALfloat);
+    case FmtIMA4: break; /* not handled here */
     }
     return 0;
 }
@@ -2183,10 +3580,12 @@ static ALboolean DecomposeFormat(ALenum format, enum FmtChannels *chans, enum Fm
         { AL_MONO8_SOFT,   FmtMono, FmtByte  },
         { AL_MONO16_SOFT,  FmtMono, FmtShort },
         { AL_MONO32F_SOFT, FmtMono, FmtFloat },
+        { AL_FORMAT_MONO_IMA4, FmtMono, FmtIMA4 },
 
         { AL_STEREO8_SOFT,   FmtStereo, FmtByte  },
         { AL_STEREO16_SOFT,  FmtStereo, FmtShort },
         { AL_STEREO32F_SOFT, FmtStereo, FmtFloat },
+        { AL_FORMAT_STEREO_IMA4, FmtStereo, FmtIMA4 },
 
         { AL_REAR8_SOFT,   FmtRear, FmtByte  },
         { AL_REAR16_SOFT,  FmtRear, FmtShort },
@@ -2276,7 +3675,8 @@ ALvoid ReleaseALBuffers(ALCdevice *device)
         ALbuffer *temp = device->BufferMap.array[i].value;
         device->BufferMap.array[i].value = NULL;
 
-        free(temp->data);
+        WaitForBufferUpload(temp);
+        FreeBufferData(temp);
 
         FreeThunkEntry(temp->buffer);
         memset(temp, 0, sizeof(ALbuffer));
@@ -49,6 +49,96 @@ const ALsizei ResamplerPrePadding[ResamplerMax] = {
 static ALvoid InitSourceParams(ALsource *Source);
 static ALvoid GetSourceOffset(ALsource *Source, ALenum eName, ALdouble *Offsets, ALdouble updateLen);
 static ALint GetSampleOffset(ALsource *Source);
+static ALfloat GetSourceLevel(const ALsource *Source);
+
+
+/* Sources are allocated in blocks, an odd number of cache lines apart. The
+ * mixer state at the start of each source then begins a cache line, and the
+ * sources' lines spread over all the cache sets. Allocated one at a time,
+ * sources can end up a power of two apart, with their mixer state all
+ * competing for the same few sets. */
+#define SOURCE_STRIDE  ((((sizeof(ALsource)+CACHE_LINE_SIZE-1)/CACHE_LINE_SIZE) | 1) * \
+                        CACHE_LINE_SIZE)
+#define SOURCES_PER_BLOCK 16
+
+/* Sits on the first cache line of a block, before its sources. */
+struct ALsourceBlock {
+    struct ALsourceBlock *next;
+};
+
+static ALsource *AllocSource(ALCcontext *Context)
+{
+    ALsource *source;
+
+    LockContext(Context);
+    if(!Context->FreeSources)
+    {
+        ALubyte *block = al_calloc(CACHE_LINE_SIZE, CACHE_LINE_SIZE +
+                                   SOURCES_PER_BLOCK*SOURCE_STRIDE);
+        if(block)
+        {
+            ALsizei i;
+
+            ((struct ALsourceBlock*)block)->next = Context->SourceBlocks;
+            Context->SourceBlocks = (struct ALsourceBlock*)block;
+            for(i = SOURCES_PER_BLOCK-1;i >= 0;i--)
+            {
+                source = (ALsource*)(block + CACHE_LINE_SIZE + i*SOURCE_STRIDE);
+                source->NextFree = Context->FreeSources;
+                Context->FreeSources = source;
+            }
+        }
+    }
+    source = Context->FreeSources;
+    if(source)
+    {
+        Context->FreeSources = source->NextFree;
+        source->NextFree = NULL;
+    }
+    UnlockContext(Context);
+
+    return source;
+}
+
+static ALvoid FreeSource(ALCcontext *Context, ALsource *Source)
+{
+    memset(Source, 0, sizeof(ALsource));
+
+    LockContext(Context);
+    Source->NextFree = Context->FreeSources;
+    Context->FreeSources = Source;
+    UnlockContext(Context);
+}
+
+/* Makes sure a buffer given to a source has no upload pending, waiting for it
+ * unless configured to reject such buffers. This must be done without the
+ * context locked, so the mixer isn't held up. */
+static ALboolean WaitBufferReady(ALbuffer *buffer)
+{
+    if(!buffer || !buffer->UploadPending)
+        return AL_TRUE;
+    if(!WaitPendingBuffers)
+        return AL_FALSE;
+    WaitForBufferUpload(buffer);
+    return AL_TRUE;
+}
+
+/* Takes a reference on a buffer being given to a source. An async upload can
+ * start between WaitBufferReady and taking the reference, but none can start
+ * while it's held, so the check is repeated here. Returns AL_FALSE, without a
+ * reference, if an upload is pending. */
+static ALboolean HoldReadyBuffer(ALbuffer *buffer)
+{
+    ALboolean ready;
+
+    IncrementRef(&buffer->ref);
+    ReadLock(&buffer->lock);
+    ready = (buffer->UploadPending ? AL_FALSE : AL_TRUE);
+    ReadUnlock(&buffer->lock);
+    if(!ready)
+        DecrementRef(&buffer->ref);
+    return ready;
+}
 
 
 AL_API ALvoid AL_APIENTRY alGenSources(ALsizei n,ALuint *sources)
@@ -69,7 +159,7 @@ AL_API ALvoid AL_APIENTRY alGenSources(ALsizei n,ALuint *sources)
         i = 0;
         while(i < n)
         {
-            ALsource *source = calloc(1, sizeof(ALsource));
+            ALsource *source = AllocSource(Context);
             if(!source)
             {
                 alSetError(Context, AL_OUT_OF_MEMORY);
@@ -84,8 +174,7 @@ AL_API ALvoid AL_APIENTRY alGenSources(ALsizei n,ALuint *sources)
             if(err != AL_NO_ERROR)
             {
                 FreeThunkEntry(source->source);
-                memset(source, 0, sizeof(ALsource));
-                free(source);
+                FreeSource(Context, source);
 
                 alSetError(Context, err);
                 alDeleteSources(i, sources);
@@ -169,8 +258,10 @@ AL_API ALvoid AL_APIENTRY alDeleteSources(ALsizei n, const ALuint *sources)
                 Source->Send[j].Slot = NULL;
             }
 
-            memset(Source,0,sizeof(ALsource));
-            free(Source);
+            free(Source->HrtfState);
+            Source->HrtfState = NULL;
+
+            FreeSource(Context, Source);
         }
     }
 
@@ -556,13 +647,29 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                 break;
 
             case AL_BUFFER:
+                if(!WaitBufferReady(lValue ? LookupBuffer(device, lValue) : NULL))
+                {
+                    alSetError(pContext, AL_INVALID_OPERATION);
+                    break;
+                }
+                /* The source's state is checked again once the context is
+                 * locked. This just saves making a copy it can't take */
+                if(lValue && (Source->state == AL_STOPPED ||
+                              Source->state == AL_INITIAL))
+                    PrepareResampledBuffer(LookupBuffer(device, lValue),
+                                           device->Frequency);
+
                 LockContext(pContext);
                 if(Source->state == AL_STOPPED || Source->state == AL_INITIAL)
                 {
                     ALbufferlistitem *oldlist;
                     ALbuffer *buffer = NULL;
 
-                    if(lValue == 0 || (buffer=LookupBuffer(device, lValue)) != NULL)
+                    if(lValue != 0 && (buffer=LookupBuffer(device, lValue)) == NULL)
+                        alSetError(pContext, AL_INVALID_VALUE);
+                    else if(buffer != NULL && !HoldReadyBuffer(buffer))
+                        alSetError(pContext, AL_INVALID_OPERATION);
+                    else
                     {
                         Source->BuffersInQueue = 0;
                         Source->BuffersPlayed = 0;
@@ -578,15 +685,12 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                             BufferListItem->buffer = buffer;
                             BufferListItem->next = NULL;
                             BufferListItem->prev = NULL;
-                            // Increment reference counter for buffer
-                            IncrementRef(&buffer->ref);
 
                             oldlist = ExchangePtr((XchgPtr*)&Source->queue, BufferListItem);
                             Source->BuffersInQueue = 1;
 
                             ReadLock(&buffer->lock);
                             Source->NumChannels = ChannelsFromFmt(buffer->FmtChannels);
-                            Source->SampleSize  = BytesFromFmt(buffer->FmtType);
                             ReadUnlock(&buffer->lock);
                             if(buffer->FmtChannels == FmtMono)
                                 Source->Update = CalcSourceParams;
@@ -612,8 +716,6 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                             free(BufferListItem);
                         }
                     }
-                    else
-                        alSetError(pContext, AL_INVALID_VALUE);
                 }
                 else
                     alSetError(pContext, AL_INVALID_OPERATION);
@@ -714,6 +816,11 @@ AL_API ALvoid AL_APIENTRY alSourcei(ALuint source,ALenum eParam,ALint lValue)
                     alSetError(pContext, AL_INVALID_VALUE);
                 break;
 
+            case AL_SOURCE_PRIORITY_SOFTX:
+                Source->Priority = lValue;
+                Source->NeedsUpdate = AL_TRUE;
+                break;
+
             case AL_DISTANCE_MODEL:
                 if(lValue == AL_NONE ||
                    lValue == AL_INVERSE_DISTANCE ||
@@ -837,6 +944,7 @@ AL_API void AL_APIENTRY alSourceiv(ALuint source, ALenum eParam, const ALint* pl
             case AL_AUXILIARY_SEND_FILTER_GAINHF_AUTO:
             case AL_DISTANCE_MODEL:
             case AL_DIRECT_CHANNELS_SOFT:
+            case AL_SOURCE_PRIORITY_SOFTX:
                 alSourcei(source, eParam, plValues[0]);
                 return;
 
@@ -956,6 +1064,12 @@ AL_API ALvoid AL_APIENTRY alGetSourcef(ALuint source, ALenum eParam, ALfloat *pf
                     *pflValue = Source->DopplerFactor;
                     break;
 
+                case AL_SOURCE_LEVEL_SOFTX:
+                    LockContext(pContext);
+                    *pflValue = GetSourceLevel(Source);
+                    UnlockContext(pContext);
+                    break;
+
                 default:
                     alSetError(pContext, AL_INVALID_ENUM);
                     break;
@@ -1050,6 +1164,7 @@ AL_API ALvoid AL_APIENTRY alGetSourcefv(ALuint source, ALenum eParam, ALfloat *p
         case AL_CONE_OUTER_GAINHF:
         case AL_AIR_ABSORPTION_FACTOR:
         case AL_ROOM_ROLLOFF_FACTOR:
+        case AL_SOURCE_LEVEL_SOFTX:
             alGetSourcef(source, eParam, pflValues);
             return;
 
@@ -1213,6 +1328,10 @@ AL_API ALvoid AL_APIENTRY alGetSourcei(ALuint source, ALenum eParam, ALint *plVa
                     *plValue = Source->DirectChannels;
                     break;
 
+                case AL_SOURCE_PRIORITY_SOFTX:
+                    *plValue = Source->Priority;
+                    break;
+
                 case AL_DISTANCE_MODEL:
                     *plValue = Source->DistanceModel;
                     break;
@@ -1316,6 +1435,7 @@ AL_API void AL_APIENTRY alGetSourceiv(ALuint source, ALenum eParam, ALint* plVal
         case AL_AUXILIARY_SEND_FILTER_GAINHF_AUTO:
         case AL_DISTANCE_MODEL:
         case AL_DIRECT_CHANNELS_SOFT:
+        case AL_SOURCE_PRIORITY_SOFTX:
             alGetSourcei(source, eParam, plValues);
             return;
 
@@ -1605,6 +1725,18 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
         goto error;
     }
 
+    device = Context->Device;
+
+    // Pending uploads have to finish before the context is locked
+    for(i = 0;i < n;i++)
+    {
+        if(buffers[i] && !WaitBufferReady(LookupBuffer(device, buffers[i])))
+        {
+            alSetError(Context, AL_INVALID_OPERATION);
+            goto error;
+        }
+    }
+
     LockContext(Context);
     // Check that this is not a STATIC Source
     if(Source->lSourceType == AL_STATIC)
@@ -1615,8 +1747,6 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
         goto error;
     }
 
-    device = Context->Device;
-
     BufferFmt = NULL;
 
     // Check existing Queue (if any) for a valid Buffers and get its frequency and format
@@ -1662,12 +1792,19 @@ AL_API ALvoid AL_APIENTRY alSourceQueueBuffers(ALuint source, ALsizei n, const A
         // Increment reference counter for buffer
         IncrementRef(&buffer->ref);
         ReadLock(&buffer->lock);
+        // An async upload may have started since the wait above
+        if(buffer->UploadPending)
+        {
+            ReadUnlock(&buffer->lock);
+            UnlockContext(Context);
+            alSetError(Context, AL_INVALID_OPERATION);
+            goto error;
+        }
         if(BufferFmt == NULL)
         {
             BufferFmt = buffer;
 
             Source->NumChannels = ChannelsFromFmt(buffer->FmtChannels);
-            Source->SampleSize  = BytesFromFmt(buffer->FmtType);
             if(buffer->FmtChannels == FmtMono)
                 Source->Update = CalcSourceParams;
             else
@@ -1823,10 +1960,12 @@ static ALvoid InitSourceParams(ALsource *Source)
     Source->RoomRolloffFactor = 0.0f;
     Source->DopplerFactor = 1.0f;
     Source->DirectChannels = AL_FALSE;
+    Source->Priority = 0;
 
     Source->DistanceModel = DefaultDistanceModel;
 
     Source->Resampler = DefaultResampler;
+    Source->LodResampler = DefaultResampler;
 
     Source->state = AL_INITIAL;
     Source->new_state = AL_NONE;
@@ -1845,6 +1984,7 @@ static ALvoid InitSourceParams(ALsource *Source)
 
     Source->HrtfMoving = AL_FALSE;
     Source->HrtfCounter = 0;
+    Source->HrtfLod = HrtfLodFull;
 }
 
 
@@ -1869,16 +2009,23 @@ ALvoid SetSourceState(ALsource *Source, ALCcontext *Context, ALenum state)
             BufferList = BufferList->next;
         }
 
-        if(Source->state != AL_PLAYING)
+        /* The HRTF state is only needed on a device using HRTF. If it can't
+         * be allocated, the source is mixed without HRTF. */
+        if(Context->Device->Hrtf)
         {
-            for(j = 0;j < MAXCHANNELS;j++)
+            if(!Source->HrtfState)
+                Source->HrtfState = calloc(1, sizeof(*Source->HrtfState));
+            else if(Source->state != AL_PLAYING)
             {
-                for(k = 0;k < SRC_HISTORY_LENGTH;k++)
-                    Source->HrtfHistory[j][k] = 0.0f;
-                for(k = 0;k < HRIR_LENGTH;k++)
+                for(j = 0;j < MAXCHANNELS;j++)
                 {
-                    Source->HrtfValues[j][k][0] = 0.0f;
-                    Source->HrtfValues[j][k][1] = 0.0f;
+                    for(k = 0;k < SRC_HISTORY_LENGTH;k++)
+                        Source->HrtfState->History[j][k] = 0.0f;
+                    for(k = 0;k < HRIR_LENGTH;k++)
+                    {
+                        Source->HrtfState->Values[j][k][0] = 0.0f;
+                        Source->HrtfState->Values[j][k][1] = 0.0f;
+                    }
                 }
             }
         }
@@ -2118,6 +2265,35 @@ ALboolean ApplyOffset(ALsource *Source)
 }
 
 
+/*
+    GetSourceLevel
+
+    Gets the RMS level of the buffer data at the Source's current playback
+    position, from the buffer's envelope. Buffers without an envelope are
+    taken to be at full level, and stopped sources are silent.
+*/
+static ALfloat GetSourceLevel(const ALsource *Source)
+{
+    const ALbufferlistitem *BufferList;
+    const ALbuffer *Buffer;
+    ALuint i;
+
+    if(Source->state != AL_PLAYING && Source->state != AL_PAUSED)
+        return 0.0f;
+
+    BufferList = Source->queue;
+    for(i = 0;BufferList && i < Source->BuffersPlayed;i++)
+        BufferList = BufferList->next;
+    if(!BufferList || (Buffer=BufferList->buffer) == NULL)
+        return 0.0f;
+
+    if(Source->position >= (ALuint)Buffer->SampleLen)
+        return 0.0f;
+    if(!Buffer->Envelope)
+        return 1.0f;
+    return Buffer->Envelope[Source->position/ENVELOPE_BLOCK_SIZE][1] / 65535.0f;
+}
+
 /*
     GetSampleOffset
 
@@ -2182,6 +2358,17 @@ static ALint GetSampleOffset(ALsource *Source)
 }
 
 
+ALvoid ReleaseALSourceBlocks(ALCcontext *Context)
+{
+    while(Context->SourceBlocks)
+    {
+        struct ALsourceBlock *next = Context->SourceBlocks->next;
+        al_free(Context->SourceBlocks);
+        Context->SourceBlocks = next;
+    }
+    Context->FreeSources = NULL;
+}
+
 ALvoid ReleaseALSources(ALCcontext *Context)
 {
     ALsizei pos;
@@ -2209,9 +2396,11 @@ ALvoid ReleaseALSources(ALCcontext *Context)
             temp->Send[j].Slot = NULL;
         }
 
+        free(temp->HrtfState);
+        temp->HrtfState = NULL;
+
         // Release source structure
         FreeThunkEntry(temp->source);
         memset(temp, 0, sizeof(ALsource));
-        free(temp);
     }
 }
@@ -258,6 +258,35 @@ AL_API ALboolean AL_APIENTRY alIsBufferFormatSupportedSOFT(ALenum format);
 #define AL_DIRECT_CHANNELS_SOFT                  0x1033
 #endif
 
+#ifndef AL_SOFTX_source_priority
+#define AL_SOFTX_source_priority 1
+#define AL_SOURCE_PRIORITY_SOFTX                 0x1040
+#endif
+
+#ifndef AL_SOFTX_buffer_file
+#define AL_SOFTX_buffer_file 1
+typedef void (AL_APIENTRY*LPALBUFFERFILESOFT)(ALuint,const ALchar*,ALenum,ALsizei);
+typedef void (AL_APIENTRY*LPALBUFFERFILEDESCRIPTORSOFT)(ALuint,ALint,ALenum,ALsizei);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferFileSOFT(ALuint buffer, const ALchar *filename, ALenum format, ALsizei freq);
+AL_API void AL_APIENTRY alBufferFileDescriptorSOFT(ALuint buffer, ALint fd, ALenum format, ALsizei freq);
+#endif
+#endif
+
+#ifndef AL_SOFTX_buffer_async
+#define AL_SOFTX_buffer_async 1
+#define AL_BUFFER_READY_SOFTX                    0x1041
+typedef void (AL_APIENTRY*LPALBUFFERDATAASYNCSOFT)(ALuint,ALenum,const ALvoid*,ALsizei,ALsizei);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferDataAsyncSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq);
+#endif
+#endif
+
+#ifndef AL_SOFTX_source_level
+#define AL_SOFTX_source_level 1
+#define AL_SOURCE_LEVEL_SOFTX                    0x1042
+#endif
+
 #ifndef ALC_SOFT_loopback
 #define ALC_SOFT_loopback 1
 #define ALC_FORMAT_CHANNELS_SOFT                 0x1990
@@ -290,6 +319,14 @@ ALC_API void ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffe
 #endif
 #endif
 
+#ifndef ALC_SOFTX_buffer_import
+#define ALC_SOFTX_buffer_import 1
+typedef ALCboolean (ALC_APIENTRY*LPALCIMPORTBUFFERSOFT)(ALCdevice*,ALCuint,ALCdevice*,ALCuint);
+#ifdef AL_ALEXT_PROTOTYPES
+ALC_API ALCboolean ALC_APIENTRY alcImportBufferSOFT(ALCdevice *device, ALCuint buffer, ALCdevice *srcdevice, ALCuint srcbuffer);
+#endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif